@@ -1,139 +1,104 @@
-/* Revised parser */
+/* Revised parser. The caller picks the temporary that holds each
+ * subexpression's value. Code goes into a quad array (see ir.c) that's
+ * printed at the end of each statement.
+ */
 
 #include <stdio.h>
-#include <stdarg.h>
 #include <stdbool.h>
 #include "lex.h"
+#include "ir.h"
+#include "parser.h"
 
-void *factor(char *tempvar);
-void *term(char *tempvar);
-void *expression(char *tempvar);
-bool legal_lookahead(token_t first_arg,...);
-extern char *newname(void);
-extern void freename(char *name);
+static void factor(compiler_t *c, ir_t *ir, int tempvar);
+static void term(compiler_t *c, ir_t *ir, int tempvar);
+static void expression(compiler_t *c, ir_t *ir, int tempvar);
 
-void statements(void)
+void args_statements(compiler_t *c)
 {
     /* statements -> expression SEMI | expression SEMI statements */
-    char *tempvar;
-    while (! match(EOI)) {
-        expression(tempvar = newname());
-        freename(tempvar);
-
-        if (match(SEMI)) {
-            advance();
+    ir_t ir;
+    int tempvar, line, errors;
+    char *start;
+
+    ir_init(&ir);
+    while (! match(c, EOI)) {
+        start = c->text;
+        line = c->lineno;
+        errors = c->nerrs;
+        ir_clear(&ir);
+        expression(c, &ir, tempvar = newtemp(c));
+
+        if (match(c, SEMI)) {
+            advance(c);
         } else {
-            fprintf(stderr, "%d: Inserting missing semicolon\n", yylineno);
+            yyerror(c, "Inserting missing semicolon");
+            if (c->text == start && c->lineno == line) {
+                advance(c);     /* nothing could be made of it: drop it */
+            }
         }
 
-        freename(tempvar);
+        freetemp(c, tempvar);
+        optimize(&ir);
+        generate(c, &ir, c->nerrs == errors);
+        out_sync(c->out);
     }
+    ir_free(&ir);
 }
 
-void *expression(char *tempvar)
+static void expression(compiler_t *c, ir_t *ir, int tempvar)
 {
     /* expression -> term expression'
      * expression' -> PLUS term expression' | epsilon */
-    char *tempvar2;
-
-    term(tempvar);
-    while (match(PLUS)) {
-        advance();
-        term(tempvar2 = newname());
-        printf("    %s += %s\n", tempvar, tempvar2);
-        freename(tempvar2);
+    int tempvar2;
+
+    term(c, ir, tempvar);
+    while (match(c, PLUS)) {
+        advance(c);
+        term(c, ir, tempvar2 = newtemp(c));
+        ir_gen(ir, Q_ADD, TEMP(tempvar), TEMP(tempvar), TEMP(tempvar2));
+        freetemp(c, tempvar2);
     }
-
-    return tempvar;
 }
 
-void *term(char *tempvar)
+static void term(compiler_t *c, ir_t *ir, int tempvar)
 {
     /* term -> factor term' 
      * term' -> TIMES factor term'
      *       |  epsilon
      */
-    char *tempvar2;
-
-    factor(tempvar);
-    while (match(TIMES)) {
-        advance();
-        factor(tempvar2 = newname());
-        printf("    %s *= %s\n", tempvar, tempvar2);
-        freename(tempvar2);
+    int tempvar2;
+
+    factor(c, ir, tempvar);
+    while (match(c, TIMES)) {
+        advance(c);
+        factor(c, ir, tempvar2 = newtemp(c));
+        ir_gen(ir, Q_MUL, TEMP(tempvar), TEMP(tempvar), TEMP(tempvar2));
+        freetemp(c, tempvar2);
     }
 }
 
-void *factor(char *tempvar)
+static void factor(compiler_t *c, ir_t *ir, int tempvar)
 {
-    /* factor -> NUM_OR_ID
+    /* factor -> NUM
+     *        |  ID
      *        |  LP expression RP
      */
 
-    if (match(NUM_OR_ID)) {
-        printf("    %s = %.*s\n", tempvar, yyleng, yytext);
-        advance();
-    } else if (match(LP)) {
-        advance();
-        expression(tempvar);
-        if (match(RP)) {
-            advance();
+    if (match(c, NUM)) {
+        ir_gen(ir, Q_MOVE, TEMP(tempvar), ir_num(ir, c->lval), 0);
+        advance(c);
+    } else if (match(c, ID)) {
+        ir_gen(ir, Q_MOVE, TEMP(tempvar), ir_id(ir, c->text, c->leng), 0);
+        advance(c);
+    } else if (match(c, LP)) {
+        advance(c);
+        expression(c, ir, tempvar);
+        if (match(c, RP)) {
+            advance(c);
         } else {
-            fprintf(stderr, "%d: Mismatched parenthesis\n", yylineno);
+            yyerror(c, "Mismatched parenthesis");
         }
     } else {
-        fprintf(stderr, "%d: Number of identifier expected\n", yylineno);
+        yyerror(c, "Number of identifier expected");
     }
 }
-
-#define MAXFIRST 16
-#define SYNCH   SEMI
-bool legal_lookahead(token_t first_arg,...)
-{
-    /* simple error detection and recovery. Arguments are a 0-terminated list
-     * of those token that can legitimately come next in the input. If the
-     * list is empty, the end of file must come next. Print an error message
-     * if necessary. Error recovery is performed by discarding all input
-     * symboals until one that's in the input list is found
-     *
-     * Return treu if there's no error or if we recovered from the error,
-     * false if we can't recover.
-     */
-    va_list args;
-    token_t tok;
-    token_t lookaheads[MAXFIRST], *p = lookaheads, *current;
-    int error_printed = 0;
-    int ret_val = 0;
-
-    va_start(args, first_arg);
-
-    if (! first_arg) {
-        if (match(EOF)) {
-            ret_val = true;
-        }
-    } else {
-        *p++ = first_arg;
-        while ((tok = va_arg(args, token_t)) && p < &lookaheads[MAXFIRST]) {
-            *++p = tok;
-        }
-        while (!match(SYNCH)) {
-            for(current = lookaheads; current < p; ++current) {
-                if (match(*current)) {
-                    ret_val = true;
-                    goto exit;
-                }
-            }
-
-            if (! error_printed) {
-                fprintf(stderr, "Line %d: Syntax error\n", yylineno);
-                error_printed = 1;
-            }
-
-            advance();
-        }
-    }
-
-exit:
-    va_end(args);
-    return ret_val;
-}
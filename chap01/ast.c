@@ -0,0 +1,212 @@
+/* ast.c
+ *
+ * Arena allocation for syntax trees. Allocation just bumps a counter; the
+ * node and text arrays double when they fill up, and so does the hash
+ * table used to find a node that's already been built.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ast.h"
+
+static void *grow(void *buf, uint32_t *max, size_t size, uint32_t need)
+{
+    if (need <= *max) {
+        return buf;
+    }
+    while (*max < need) {
+        *max = *max ? *max * 2 : 1024;
+    }
+    if (!(buf = realloc(buf, *max * size))) {
+        fprintf(stderr, "Out of memory for syntax tree\n");
+        exit(1);
+    }
+    return buf;
+}
+
+void ast_init(arena_t *arena)
+{
+    memset(arena, 0, sizeof(*arena));
+    arena->nodes = grow(NULL, &arena->maxnodes, sizeof(ast_node), 1);
+    arena->nnodes = 1;
+}
+
+void ast_free(arena_t *arena)
+{
+    free(arena->nodes);
+    free(arena->text);
+    free(arena->hash);
+    memset(arena, 0, sizeof(*arena));
+}
+
+static uint32_t hash(arena_t *arena, ast_node *p, const char *name);
+
+void ast_reset(arena_t *arena)
+{
+    /* Throw away every node but keep the memory. When only a few slots of
+     * the hash table are in use they're found and emptied one by one, so
+     * that a table made big by one long statement doesn't have to be
+     * cleared after every short one.
+     */
+    ast_node *p;
+    node_t n;
+    uint32_t slot;
+
+    if (arena->nnodes < arena->hashsize / 16) {
+        for (n = 1; n < arena->nnodes; ++n) {
+            p = AST(arena, n);
+            slot = hash(arena, p, p->op == ID ? AST_NAME(arena, p) : NULL)
+                   & (arena->hashsize - 1);
+            while (arena->hash[slot] != n) {
+                slot = (slot + 1) & (arena->hashsize - 1);
+            }
+            arena->hash[slot] = 0;
+        }
+    } else if (arena->hash) {
+        memset(arena->hash, 0, arena->hashsize * sizeof(node_t));
+    }
+    arena->nnodes = 1;
+    arena->ntext = 0;
+}
+
+static uint32_t hash(arena_t *arena, ast_node *p, const char *name)
+{
+    uint32_t h = 2166136261u ^ p->op;   /* FNV-1a */
+    uint32_t i;
+
+    switch (p->op) {
+        case NUM:
+            h = (h ^ (uint32_t)p->u.value) * 16777619u;
+            h = (h ^ (uint32_t)(p->u.value >> 32)) * 16777619u;
+            break;
+        case ID:
+            for (i = 0; i < p->u.id.len; ++i) {
+                h = (h ^ (unsigned char)name[i]) * 16777619u;
+            }
+            break;
+        default:
+            h = (h ^ p->u.kids.left) * 16777619u;
+            h = (h ^ p->u.kids.right) * 16777619u;
+            break;
+    }
+    return h;
+}
+
+static bool same(arena_t *arena, ast_node *p, ast_node *q, const char *name)
+{
+    if (p->op != q->op) {
+        return false;
+    }
+    switch (p->op) {
+        case NUM:
+            return p->u.value == q->u.value;
+        case ID:
+            return p->u.id.len == q->u.id.len
+                   && memcmp(AST_NAME(arena, p), name, q->u.id.len) == 0;
+        default:
+            return p->u.kids.left == q->u.kids.left
+                   && p->u.kids.right == q->u.kids.right;
+    }
+}
+
+static void rehash(arena_t *arena)
+{
+    ast_node *p;
+    node_t n;
+    uint32_t slot;
+
+    free(arena->hash);
+    arena->hashsize = arena->hashsize ? arena->hashsize * 2 : 1024;
+    if (!(arena->hash = calloc(arena->hashsize, sizeof(node_t)))) {
+        fprintf(stderr, "Out of memory for syntax tree\n");
+        exit(1);
+    }
+    for (n = 1; n < arena->nnodes; ++n) {
+        p = AST(arena, n);
+        slot = hash(arena, p, p->op == ID ? AST_NAME(arena, p) : NULL)
+               & (arena->hashsize - 1);
+        while (arena->hash[slot]) {
+            slot = (slot + 1) & (arena->hashsize - 1);
+        }
+        arena->hash[slot] = n;
+    }
+}
+
+static node_t intern(arena_t *arena, ast_node *proto, const char *name)
+{
+    /* Return the node that matches proto (with "name" the spelling of an
+     * ID), making it if there isn't one yet.
+     */
+    uint32_t slot;
+    node_t n;
+
+    if (2 * arena->nnodes >= arena->hashsize) {
+        rehash(arena);
+    }
+    slot = hash(arena, proto, name) & (arena->hashsize - 1);
+    while ((n = arena->hash[slot])) {
+        if (same(arena, AST(arena, n), proto, name)) {
+            return n;
+        }
+        slot = (slot + 1) & (arena->hashsize - 1);
+    }
+
+    arena->nodes = grow(arena->nodes, &arena->maxnodes, sizeof(ast_node),
+                        arena->nnodes + 1);
+    n = arena->nnodes++;
+    *AST(arena, n) = *proto;
+    if (proto->op == ID) {
+        /* The spelling is copied, since the lexer's buffer won't keep it. */
+        arena->text = grow(arena->text, &arena->maxtext, 1,
+                           arena->ntext + proto->u.id.len);
+        memcpy(arena->text + arena->ntext, name, proto->u.id.len);
+        AST(arena, n)->u.id.name = arena->ntext;
+        arena->ntext += proto->u.id.len;
+    }
+    arena->hash[slot] = n;
+    return n;
+}
+
+node_t ast_num(arena_t *arena, unsigned long value)
+{
+    ast_node node = { .op = NUM, .need = 1 };
+
+    node.u.value = value;
+    return intern(arena, &node, NULL);
+}
+
+node_t ast_id(arena_t *arena, const char *name, int len)
+{
+    ast_node node = { .op = ID, .need = 1 };
+
+    node.u.id.len = len;
+    return intern(arena, &node, name);
+}
+
+node_t ast_binary(arena_t *arena, token_t op, node_t left, node_t right)
+{
+    /* A missing operand has already been reported as a syntax error; keep
+     * whatever is left of the expression rather than a half-built node.
+     */
+    ast_node node = { .op = op };
+
+    if (!left || !right) {
+        return left ? left : right;
+    }
+    node.u.kids.left = left;
+    node.u.kids.right = right;
+
+    /* Label the node as it's built: two subtrees that need the same number
+     * of temporaries need one more between them, otherwise the bigger one
+     * can be evaluated first and its temporaries reused for the other.
+     */
+    if (AST(arena, left)->need == AST(arena, right)->need) {
+        node.need = AST(arena, left)->need + 1;
+    } else if (AST(arena, left)->need > AST(arena, right)->need) {
+        node.need = AST(arena, left)->need;
+    } else {
+        node.need = AST(arena, right)->need;
+    }
+    return intern(arena, &node, NULL);
+}
@@ -0,0 +1,67 @@
+/* ast.h
+ *
+ * Abstract syntax trees for the expression language, allocated from an
+ * arena. Nodes live in one contiguous array and refer to their children by
+ * 32-bit index, so the arena can grow without invalidating anything and the
+ * whole tree goes away with a single ast_free(), or with ast_reset() if the
+ * arena is to be used again.
+ *
+ * Nodes are hash-consed: asking for a node that's already in the arena
+ * (the same number, the same identifier, or the same operator on the same
+ * children) returns the existing one, so two expressions with the same
+ * structure get the same node, and the trees are really a DAG.
+ */
+#ifndef AST_H
+#define AST_H
+
+#include <stdint.h>
+#include "lex.h"
+
+typedef uint32_t node_t;    /* index of a node in its arena, 0 for none */
+
+typedef struct {
+    uint16_t op;            /* NUM, ID, or the token of a binary operator */
+    uint16_t need;          /* Sethi-Ullman number: temporaries needed to
+                               evaluate the subtree */
+    union {
+        unsigned long value;            /* NUM */
+        struct {
+            uint32_t name;              /* offset of spelling in text */
+            uint32_t len;
+        } id;                           /* ID */
+        struct {
+            node_t left, right;
+        } kids;                         /* PLUS, TIMES */
+    } u;
+} ast_node;
+
+typedef struct {
+    ast_node *nodes;        /* nodes[0] is reserved so 0 can mean "none" */
+    uint32_t nnodes, maxnodes;
+    char     *text;         /* identifier spellings, back to back */
+    uint32_t ntext, maxtext;
+    node_t   *hash;         /* open-addressed index into nodes, 0 empty */
+    uint32_t hashsize;      /* a power of two */
+} arena_t;
+
+/* Most bytes of nodes and text an arena should keep from one statement to
+ * the next; see retval.c.
+ */
+#define AST_MAX     (16 * 1024 * 1024)
+
+#define AST(arena, n)       (&(arena)->nodes[n])
+#define AST_SIZE(arena)     ((arena)->nnodes * sizeof(ast_node) + (arena)->ntext)
+#define AST_NAME(arena, p)  ((arena)->text + (p)->u.id.name)
+
+/* in ast.c */
+void ast_init(arena_t *arena);
+void ast_free(arena_t *arena);
+void ast_reset(arena_t *arena);
+node_t ast_num(arena_t *arena, unsigned long value);
+node_t ast_id(arena_t *arena, const char *name, int len);
+node_t ast_binary(arena_t *arena, token_t op, node_t left, node_t right);
+
+/* in tree.c */
+node_t tree_expression(compiler_t *c, arena_t *arena);
+
+#endif /* AST_H */
@@ -0,0 +1,280 @@
+/* batch.c
+ *
+ * Columnar evaluation. A table is read into one array per column, and a
+ * statement is run over it a block of rows at a time: each temporary is a
+ * block-sized vector, and each quad is a loop over the block, written
+ * with GCC's vector extensions so that the compiler turns it into SIMD
+ * instructions. The loops are compiled twice, for AVX2 and for any x86-64
+ * (SSE2), and the right one is picked when the program starts. A block
+ * stays in the cache while all of a statement's quads pass over it.
+ *
+ * The table is text: a line naming the columns, then one line of numbers
+ * per row. An identifier that isn't a column gets its value from -D (see
+ * vm.c), the same in every row.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "lex.h"
+#include "vm.h"
+#include "batch.h"
+#include "scratch.h"
+
+#define VLEN    4                   /* unsigned longs to a vector */
+#define NVEC    (BATCH_BLOCK / VLEN)
+
+typedef unsigned long vec_t __attribute__((vector_size(VLEN * sizeof(long))));
+
+typedef struct {
+    char *name;
+    int len;
+    unsigned long *values;  /* padded to a whole number of blocks */
+} column_t;
+
+typedef struct {
+    const vec_t *v;         /* a block of values, */
+    unsigned long s;        /* or, if v is NULL, the same value throughout */
+} operand_t;
+
+size_t Batch_rows;
+static column_t *Columns;
+static int Ncolumns;
+
+static _Thread_local vec_t (*Temps)[NVEC];  /* Temps[n]: temporary n */
+static _Thread_local int Maxtemps;
+
+static void *xrealloc(void *p, size_t size)
+{
+    if (!(p = realloc(p, size))) {
+        fprintf(stderr, "Out of memory for table\n");
+        exit(1);
+    }
+    return p;
+}
+
+static void release(void)
+{
+    free(Temps);
+    Temps = NULL;
+    Maxtemps = 0;
+}
+
+static void *xalloc(void *old, size_t oldsize, size_t size)
+{
+    /* Like realloc(), but keeping vectors aligned. */
+
+    void *p;
+
+    if (!(p = aligned_alloc(sizeof(vec_t), size))) {
+        fprintf(stderr, "Out of memory for table\n");
+        exit(1);
+    }
+    if (old) {
+        memcpy(p, old, oldsize);
+        free(old);
+    }
+    return p;
+}
+
+void batch_load(const char *path)
+{
+    /* Read a table into Columns. */
+
+    FILE *fp = fopen(path, "r");
+    char *line = NULL, *p, *end;
+    size_t size = 0, maxrows = BATCH_BLOCK, i;
+    int c;
+
+    if (!fp || getline(&line, &size, fp) < 0) {
+        fprintf(stderr, "Can't read table %s\n", path);
+        exit(1);
+    }
+    for (p = line; *p; ) {
+        while (isspace((unsigned char)*p)) {
+            ++p;
+        }
+        for (end = p; *end && !isspace((unsigned char)*end); ++end)
+            ;
+        if (end > p) {
+            Columns = xrealloc(Columns, (Ncolumns + 1) * sizeof(column_t));
+            Columns[Ncolumns].len = end - p;
+            Columns[Ncolumns].name = memcpy(xrealloc(NULL, end - p), p,
+                                            end - p);
+            Columns[Ncolumns].values = xalloc(NULL, 0, maxrows * sizeof(long));
+            ++Ncolumns;
+        }
+        p = end;
+    }
+
+    while (getline(&line, &size, fp) >= 0) {
+        if (Batch_rows == maxrows) {
+            for (c = 0; c < Ncolumns; ++c) {
+                Columns[c].values = xalloc(Columns[c].values,
+                                           maxrows * sizeof(long),
+                                           2 * maxrows * sizeof(long));
+            }
+            maxrows *= 2;
+        }
+        for (p = line, c = 0; c < Ncolumns; ++c, p = end) {
+            Columns[c].values[Batch_rows] = strtoul(p, &end, 0);
+            if (end == p) {
+                break;
+            }
+        }
+        if (c == 0) {
+            continue;           /* blank line */
+        }
+        if (c < Ncolumns) {
+            fprintf(stderr, "%s: row %zu is short\n", path, Batch_rows + 1);
+            exit(1);
+        }
+        ++Batch_rows;
+    }
+
+    /* Zero the rest of the last block. */
+    for (c = 0; c < Ncolumns; ++c) {
+        for (i = Batch_rows; i % BATCH_BLOCK; ++i) {
+            Columns[c].values[i] = 0;
+        }
+    }
+    free(line);
+    fclose(fp);
+}
+
+static operand_t operand(ir_t *ir, int opnd, size_t row)
+{
+    operand_t o = { NULL, 0 };
+    int c;
+
+    switch (OPND_KIND(opnd)) {
+        case OPND_TEMP:
+            o.v = Temps[OPND_INDEX(opnd)];
+            break;
+        case OPND_NUM:
+            o.s = IR_NUM(ir, opnd);
+            break;
+        default:
+            for (c = 0; c < Ncolumns; ++c) {
+                if (Columns[c].len == IR_SYM(ir, opnd)->len
+                        && memcmp(Columns[c].name, IR_SYM_NAME(ir, opnd),
+                                  Columns[c].len) == 0) {
+                    o.v = (const vec_t *)(Columns[c].values + row);
+                    return o;
+                }
+            }
+            o.s = Vm_vars[vm_var(IR_SYM_NAME(ir, opnd), IR_SYM(ir, opnd)->len)];
+            break;
+    }
+    return o;
+}
+
+__attribute__((target_clones("avx2", "default")))
+static void quad(qop_t op, vec_t *d, operand_t a, operand_t b)
+{
+    /* d = a op b, over a block */
+
+    operand_t t;
+    int i;
+
+    if (!a.v) {                 /* both operators commute */
+        t = a;
+        a = b;
+        b = t;
+    }
+
+    if (!a.v) {
+        b.s = op == Q_ADD ? a.s + b.s : a.s * b.s;
+        for (i = 0; i < NVEC; ++i) {
+            d[i] = (vec_t){ 0 } + b.s;
+        }
+    } else if (!b.v) {
+        if (op == Q_ADD) {
+            for (i = 0; i < NVEC; ++i) {
+                d[i] = a.v[i] + b.s;
+            }
+        } else {
+            for (i = 0; i < NVEC; ++i) {
+                d[i] = a.v[i] * b.s;
+            }
+        }
+    } else {
+        if (op == Q_ADD) {
+            for (i = 0; i < NVEC; ++i) {
+                d[i] = a.v[i] + b.v[i];
+            }
+        } else {
+            for (i = 0; i < NVEC; ++i) {
+                d[i] = a.v[i] * b.v[i];
+            }
+        }
+    }
+}
+
+static int max_temp(int opnd, int n)
+{
+    /* n, or more if opnd is a temporary that needs it. */
+
+    return OPND_KIND(opnd) == OPND_TEMP && OPND_INDEX(opnd) >= n
+           ? OPND_INDEX(opnd) + 1 : n;
+}
+
+const unsigned long *batch_block(ir_t *ir, size_t row)
+{
+    /* Run a statement over the block of rows starting at "row" and return
+     * its values, or NULL for an empty statement. Temps[] is sized to hold
+     * every temporary the quads name, read as well as written, so that
+     * code that reads one it never set can't run off the end.
+     */
+    static const operand_t zero = { NULL, 0 };
+    ir_quad_t *q;
+    int n = 0;
+
+    if (ir->nquads == 0) {
+        return NULL;
+    }
+    for (q = ir->quads; q < ir->quads + ir->nquads; ++q) {
+        n = max_temp(q->dst, n);
+        n = max_temp(q->src1, n);
+        if (q->op != Q_MOVE) {
+            n = max_temp(q->src2, n);
+        }
+    }
+    if (n > Maxtemps) {
+        scratch_atexit(release);
+        free(Temps);
+        Maxtemps = n;
+        Temps = xalloc(NULL, 0, Maxtemps * sizeof(*Temps));
+    }
+
+    for (q = ir->quads; q < ir->quads + ir->nquads; ++q) {
+        if (q->op == Q_MOVE) {
+            quad(Q_ADD, Temps[OPND_INDEX(q->dst)],
+                 operand(ir, q->src1, row), zero);
+        } else {
+            quad(q->op, Temps[OPND_INDEX(q->dst)],
+                 operand(ir, q->src1, row), operand(ir, q->src2, row));
+        }
+    }
+    return (const unsigned long *)Temps[OPND_INDEX(q[-1].dst)];
+}
+
+void batch_run(ir_t *ir, out_t *out)
+{
+    /* Print a statement's value in every row. */
+
+    const unsigned long *values;
+    size_t row, i, n;
+
+    for (row = 0; row < Batch_rows; row += BATCH_BLOCK) {
+        if (!(values = batch_block(ir, row))) {
+            return;
+        }
+        n = Batch_rows - row < BATCH_BLOCK ? Batch_rows - row : BATCH_BLOCK;
+        for (i = 0; i < n; ++i) {
+            out_ulong(out, values[i]);
+            out_mem(out, "\n", 1);
+        }
+        out_sync(out);
+    }
+}
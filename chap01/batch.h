@@ -0,0 +1,20 @@
+/* batch.h
+ *
+ * Evaluating statements over a table: every identifier names a column,
+ * and a statement is run once per row.
+ */
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stddef.h>
+#include "ir.h"
+
+#define BATCH_BLOCK 1024    /* rows evaluated at a time */
+
+/* in batch.c */
+extern size_t Batch_rows;
+void batch_load(const char *path);
+const unsigned long *batch_block(ir_t *ir, size_t row);
+void batch_run(ir_t *ir, out_t *out);
+
+#endif /* BATCH_H */
@@ -0,0 +1,75 @@
+#!/bin/bash
+#
+# Throughput of the front end on synthetic input: every kind of corpus
+# that corpus.c makes, through the lexer alone (-P lex), the parsers that
+# generate no code (plain, improved), and the ones that do (retval, args).
+#
+#       ./bench.sh [statements] [options for compile...]
+#
+# The deep and wide corpora have about a hundred times as many tokens to
+# a statement, so they get a hundredth as many statements. Code goes to
+# /dev/null; a run that takes longer than a minute or dies is reported as
+# such rather than timed. The runs are timed from outside, with -r for the
+# peak memory: -t would time every token and mostly measure itself.
+#
+# Then the error-dense corpora are run at a quarter, half and all of the
+# statements, to show that error recovery stays linear: the time per token
+# should come out about the same at every size.
+
+n=${1:-100000}
+shift
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+printf "%-7s %-9s %9s %9s %10s %9s\n" corpus parser seconds "Mtok/s" "Kstmt/s" "RSS KB"
+for kind in mixed deep wide longid errors garbage; do
+    case $kind in
+        deep|wide)  count=$((n / 100)) ;;
+        *)          count=$n ;;
+    esac
+    read stmts _ tokens _ < <(./corpus -k $kind -n $count 2>&1 >"$dir/$kind")
+
+    for parser in lex plain improved retval args; do
+        TIMEFORMAT=%R
+        { time timeout 60 ./compile -r -P $parser "$@" <"$dir/$kind" \
+              >/dev/null 2>"$dir/err"; } 2>"$dir/time"
+        status=$?
+        secs=$(cat "$dir/time")
+        rss=$(sed -n 's/^Peak RSS: \([0-9]*\) KB$/\1/p' "$dir/err")
+
+        if [ $status -eq 124 ]; then
+            printf "%-7s %-9s %9s\n" $kind $parser "timed out"
+        elif [ -z "$rss" ]; then
+            printf "%-7s %-9s %9s\n" $kind $parser "crashed"
+        else
+            awk -v k=$kind -v p=$parser -v s=$secs -v t=$tokens \
+                -v n=$stmts -v r=$rss 'BEGIN {
+                if (s <= 0) s = 0.001
+                printf "%-7s %-9s %9.3f %9.2f %10.1f %9d\n",
+                       k, p, s, t / s / 1e6, n / s / 1e3, r
+            }'
+        fi
+    done
+done
+
+echo
+printf "%-7s %-9s %9s %9s %9s\n" corpus parser statements seconds "ns/tok"
+for kind in errors garbage; do
+    for count in $((n / 4)) $((n / 2)) $n; do
+        read stmts _ tokens _ < <(./corpus -k $kind -n $count 2>&1 >"$dir/$kind")
+
+        for parser in plain improved retval args; do
+            TIMEFORMAT=%R
+            { time timeout 60 ./compile -P $parser -E 0 "$@" <"$dir/$kind" \
+                  >/dev/null 2>&1; } 2>"$dir/time"
+            if [ $? -eq 124 ]; then
+                printf "%-7s %-9s %9d %9s\n" $kind $parser $stmts "timed out"
+                continue
+            fi
+            awk -v k=$kind -v p=$parser -v s=$(cat "$dir/time") -v t=$tokens \
+                -v n=$stmts 'BEGIN {
+                printf "%-7s %-9s %9d %9.3f %9.1f\n", k, p, n, s, s / t * 1e9
+            }'
+        done
+    done
+done
@@ -0,0 +1,93 @@
+#!/bin/bash
+#
+# Regression checks for the compiler: each one runs ./compile on input made
+# up on the spot and compares what it prints with what it should.
+#
+#       ./check.sh
+#
+# Prints a line for every check that fails, and exits 1 if any did.
+
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+failed=0
+
+fail()
+{
+    echo "FAIL: $1"
+    failed=1
+}
+
+# A statement whose code is bigger than an output buffer (OUT_FLUSH in
+# out.h), twice, after enough short ones to have the buffer part full:
+# the second copy comes from the memo and has to be the same as the first.
+awk 'BEGIN {
+    for (i = 0; i < 21000; ++i) print "a1;"
+    for (n = 0; n < 2; ++n) {
+        for (i = 0; i < 45000; ++i) printf "%sv%d", i ? " + " : "", i % 50
+        print ";"
+    }
+}' >"$dir/big"
+./compile <"$dir/big" >"$dir/memo" || fail "big statement: compile exited with $?"
+./compile -M <"$dir/big" >"$dir/nomemo"
+cmp -s "$dir/memo" "$dir/nomemo" || fail "big statement: memo output differs from -M"
+
+# A corpus, and a value for every identifier it can use, so that the
+# evaluating back ends have something to work on.
+./corpus -n 20000 -s 1 >"$dir/corpus" 2>/dev/null
+defs=()
+for l in {a..z}; do
+    for d in {0..9}; do
+        defs+=(-D "$l$d=$(( (RANDOM % 1000) + 1 ))")
+    done
+done
+
+# Value numbering, folding and the peephole pass mustn't change what a
+# statement computes.
+for b in vm jit; do
+    ./compile -b $b "${defs[@]}" -O0 <"$dir/corpus" >"$dir/O0" 2>&1
+    ./compile -b $b "${defs[@]}" -O2 <"$dir/corpus" >"$dir/O2" 2>&1
+    cmp -s "$dir/O0" "$dir/O2" || fail "-b $b: -O0 and -O2 values differ"
+done
+
+# The corpus is cut into several chunks under -j; the code has to come out
+# the same as from a serial run.
+./compile <"$dir/corpus" >"$dir/serial"
+./compile -j4 <"$dir/corpus" >"$dir/parallel"
+cmp -s "$dir/serial" "$dir/parallel" || fail "-j4 output differs from serial"
+
+# Two snapshots under -i, the second edited and with a statement that has
+# an error: its code and messages have to be what compiling it on its own
+# gives, and clean input mustn't give any messages under any parser.
+head -n 1000 "$dir/corpus" >"$dir/snap1"
+{ head -n 400 "$dir/snap1"; echo "a1 + ;"; echo "(b2 * 3);"
+  tail -n +403 "$dir/snap1"; } >"$dir/snap2"
+{ cat "$dir/snap1"; printf '\f\n'; cat "$dir/snap2"; printf '\f\n'; } \
+    >"$dir/snaps"
+{ ./compile <"$dir/snap1"; printf '\f\n'; ./compile <"$dir/snap2"
+  printf '\f\n'; } >"$dir/whole" 2>"$dir/whole.err"
+./compile -i <"$dir/snaps" >"$dir/incr" 2>"$dir/incr.err"
+cmp -s "$dir/whole" "$dir/incr" || fail "-i: code differs from plain compiles"
+cmp -s "$dir/whole.err" "$dir/incr.err" \
+    || fail "-i: messages differ from plain compiles"
+grep -q "^401: " "$dir/incr.err" || fail "-i: no error for a missing operand"
+for p in plain improved retval args ll1; do
+    ./compile -P $p -i <"$dir/snaps" 2>&1 >/dev/null | grep -v "^401: " \
+        | grep -q . && fail "-P $p -i: messages about clean statements"
+done
+
+# A statement with an error is reported, and isn't run: the code it leaves
+# reads a temporary that was never set.
+for p in retval improved args; do
+    for b in vm jit; do
+        out=$(echo "a1 + ;" | ./compile -P $p -b $b -D a1=3 2>"$dir/err")
+        [ -z "$out" ] || fail "-P $p -b $b: ran a statement with an error"
+        [ -s "$dir/err" ] || fail "-P $p -b $b: no error for a missing operand"
+    done
+done
+
+# Error recovery scans the input once, however much of it is garbage.
+./corpus -k garbage -n 100000 -s 1 2>/dev/null \
+    | ./compile -P plain -E 0 >/dev/null 2>&1
+[ $? -lt 128 ] || fail "-P plain crashed on garbage"
+
+exit $failed
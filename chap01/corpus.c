@@ -0,0 +1,193 @@
+/* corpus.c
+ *
+ * Makes up input for benchmarks (see bench.sh): random statements of one
+ * kind, written to standard output, with a count of the statements and
+ * tokens on standard error so that throughput can be worked out.
+ *
+ *      mixed   expressions a few levels deep
+ *      deep    parentheses nested far down
+ *      wide    long sums of products
+ *      longid  identifiers hundreds of characters long
+ *      errors  mixed, with most statements broken somehow
+ *      garbage tokens and illegal characters in no order at all, the
+ *              worst case for error recovery
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static unsigned long Seed = 1;
+static long Tokens;
+
+static unsigned rnd(unsigned n)
+{
+    /* A number from 0 to n-1. The same seed gives the same corpus
+     * everywhere, which rand() doesn't promise.
+     */
+    Seed = Seed * 6364136223846793005UL + 1442695040888963407UL;
+    return (Seed >> 33) % n;
+}
+
+static void token(const char *s)
+{
+    fputs(s, stdout);
+    ++Tokens;
+}
+
+static void operand(int idlen)
+{
+    static const char letters[] = "abcdefghijklmnopqrstuvwxyz";
+    int i;
+
+    if (rnd(3) == 0) {
+        printf("%u", rnd(1000));
+    } else {
+        putchar(letters[rnd(26)]);
+        for (i = 1; i < idlen; ++i) {
+            putchar(letters[rnd(26)]);
+        }
+        if (idlen == 1) {
+            printf("%u", rnd(10));
+        }
+    }
+    ++Tokens;
+}
+
+static void expression(int depth, int idlen)
+{
+    /* expression -> operand | expression op expression | ( expression ) */
+
+    if (depth == 0 || rnd(4) == 0) {
+        operand(idlen);
+    } else if (rnd(4) == 0) {
+        token("(");
+        expression(depth - 1, idlen);
+        token(")");
+    } else {
+        expression(depth - 1, idlen);
+        token(rnd(2) ? " + " : " * ");
+        expression(depth - 1, idlen);
+    }
+}
+
+static void deep(int depth)
+{
+    int i;
+
+    for (i = 0; i < depth; ++i) {
+        token("(");
+    }
+    operand(1);
+    for (i = 0; i < depth; ++i) {
+        token(rnd(2) ? " + " : " * ");
+        operand(1);
+        token(")");
+    }
+}
+
+static void wide(int terms)
+{
+    int i;
+
+    operand(1);
+    for (i = 1; i < terms; ++i) {
+        token(rnd(3) ? " + " : " * ");
+        operand(1);
+    }
+}
+
+static void broken(void)
+{
+    /* Something a parser has to recover from. */
+
+    switch (rnd(5)) {
+        case 0:                         /* operator with nothing after it */
+            operand(1);
+            token(" +");
+            break;
+        case 1:                         /* unclosed parenthesis */
+            token("(");
+            expression(3, 1);
+            break;
+        case 2:                         /* stray closing parenthesis */
+            expression(3, 1);
+            token(")");
+            break;
+        case 3:                         /* illegal character */
+            expression(2, 1);
+            fputs(" @ ", stdout);
+            expression(2, 1);
+            break;
+        default:                        /* two operands in a row */
+            operand(1);
+            putchar(' ');
+            operand(1);
+            break;
+    }
+}
+
+static void garbage(int length)
+{
+    static const char *const junk[] = { "+", "*", "(", ")", " ", "@", "#" };
+    int i, j;
+
+    for (i = 0; i < length; ++i) {
+        if ((j = rnd(8)) == 7) {
+            operand(1);
+        } else if (j < 4) {
+            token(junk[j]);
+        } else {
+            fputs(junk[j], stdout);         /* not a token */
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const char *kind = "mixed";
+    long n = 100000, i;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "k:n:s:")) != -1) {
+        switch (opt) {
+            case 'k':   /* kind of statements */
+                kind = optarg;
+                break;
+            case 'n':   /* how many */
+                n = atol(optarg);
+                break;
+            case 's':   /* random seed */
+                Seed = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-k mixed|deep|wide|longid|errors|garbage] [-n statements] [-s seed]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    for (i = 0; i < n; ++i) {
+        if (strcmp(kind, "deep") == 0) {
+            deep(100 + rnd(100));
+        } else if (strcmp(kind, "wide") == 0) {
+            wide(100 + rnd(100));
+        } else if (strcmp(kind, "longid") == 0) {
+            expression(3, 100 + rnd(200));
+        } else if (strcmp(kind, "garbage") == 0) {
+            garbage(20 + rnd(40));
+        } else if (strcmp(kind, "errors") == 0 && rnd(4) != 0) {
+            broken();
+        } else if (strcmp(kind, "mixed") == 0 || strcmp(kind, "errors") == 0) {
+            expression(4, 1);
+        } else {
+            fprintf(stderr, "%s: unknown kind %s\n", argv[0], kind);
+            return 1;
+        }
+        token(";");
+        putchar('\n');
+    }
+
+    fprintf(stderr, "%ld statements, %ld tokens\n", n, Tokens);
+    return 0;
+}
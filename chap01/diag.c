@@ -0,0 +1,174 @@
+/* diag.c
+ *
+ * The diagnostics engine behind yyerror(). Each compilation's messages
+ * go into its own buffer, which is written to stderr whenever it fills up
+ * (at once if stderr is a terminal) and when the compilation is over, so
+ * a flood of errors costs a few big writes instead of one or two small
+ * ones a message. The buffer only ever holds whole lines, and it's written
+ * under a lock shared by every compilation, so messages from threads
+ * compiling at the same time never cut into each other, however big the
+ * writes are.
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <pthread.h>
+#include "diag.h"
+
+diag_format_t Diag_format = DIAG_TEXT;
+int Max_errors = 0;
+
+static pthread_mutex_t Lock = PTHREAD_MUTEX_INITIALIZER;
+static int Repeats;         /* merged from every compilation by diag_close() */
+
+static void flush(out_t *out)
+{
+    pthread_mutex_lock(&Lock);
+    out_flush(out);
+    pthread_mutex_unlock(&Lock);
+}
+
+static void json_string(out_t *out, const char *s)
+{
+    static const char hex[] = "0123456789abcdef";
+    char esc[6] = { '\\', 'u', '0', '0' };
+
+    out_mem(out, "\"", 1);
+    for (; *s; ++s) {
+        if (*s == '"' || *s == '\\') {
+            esc[1] = *s;
+            out_mem(out, esc, 2);
+            esc[1] = 'u';
+        } else if ((unsigned char)*s < ' ') {
+            esc[4] = hex[*s >> 4];
+            esc[5] = hex[*s & 15];
+            out_mem(out, esc, 6);
+        } else {
+            out_mem(out, s, 1);
+        }
+    }
+    out_mem(out, "\"", 1);
+}
+
+static void put(compiler_t *c, const char *msg)
+{
+    /* Add a message about the current line to the buffer. */
+
+    out_t *out = &c->diag;
+
+    if (!out->buf) {
+        out_open(out, 2);
+    }
+    if (Diag_format == DIAG_JSON) {
+        out_mem(out, "{\"file\": ", 9);
+        if (c->filename) {
+            json_string(out, c->filename);
+        } else {
+            out_mem(out, "null", 4);
+        }
+        out_mem(out, ", \"line\": ", 10);
+        out_ulong(out, c->lineno);
+        out_mem(out, ", \"message\": ", 13);
+        json_string(out, msg);
+        out_mem(out, "}\n", 2);
+    } else {
+        if (c->filename) {
+            out_mem(out, c->filename, strlen(c->filename));
+            out_mem(out, ":", 1);
+        }
+        out_ulong(out, c->lineno);
+        out_mem(out, ": ", 2);
+        out_mem(out, msg, strlen(msg));
+        out_mem(out, "\n", 1);
+    }
+    if (out->len >= out->limit) {
+        flush(out);
+    }
+}
+
+void yyerror(compiler_t *c, const char *fmt, ...)
+{
+    /* Count an error and report it, unless it's already been reported
+     * about this line or the compilation has already given up. Messages
+     * are told apart by their hashes.
+     */
+    char msg[DIAG_MAX], *p;
+    uint32_t h = 2166136261u;   /* FNV-1a */
+    va_list args;
+    int i;
+
+    ++c->nerrs;
+    if (c->stopped) {
+        return;
+    }
+
+    va_start(args, fmt);
+    vsnprintf(msg, sizeof(msg), fmt, args);
+    va_end(args);
+    for (p = msg; *p; ++p) {
+        h = (h ^ (unsigned char)*p) * 16777619u;
+    }
+    if (c->lineno != c->seenline) {
+        c->seenline = c->lineno;
+        c->nseen = 0;
+    }
+    for (i = 0; i < c->nseen; ++i) {
+        if (c->seen[i] == h) {
+            ++c->repeats;
+            return;
+        }
+    }
+    if (c->nseen < DIAG_SEEN) {
+        c->seen[c->nseen++] = h;
+    }
+    put(c, msg);
+
+    if (Max_errors && c->nerrs >= Max_errors) {
+        put(c, "Too many errors, giving up");
+        c->stopped = true;
+    }
+}
+
+void diag_close(compiler_t *c)
+{
+    /* Write out the compilation's messages, and add up the ones that
+     * weren't shown for diag_summary().
+     */
+    pthread_mutex_lock(&Lock);
+    Repeats += c->repeats;
+    c->repeats = 0;
+    if (c->diag.buf) {
+        out_flush(&c->diag);
+    }
+    pthread_mutex_unlock(&Lock);
+    if (c->diag.buf) {
+        out_close(&c->diag);
+    }
+}
+
+void diag_summary(void)
+{
+    /* Say, once for the whole run, how many messages weren't shown. It's
+     * about no line in particular, so it has no line number.
+     */
+    char msg[64];
+    out_t out;
+
+    if (!Repeats) {
+        return;
+    }
+    snprintf(msg, sizeof(msg), "%d repeated message%s not shown",
+             Repeats, Repeats == 1 ? "" : "s");
+    out_open(&out, 2);
+    if (Diag_format == DIAG_JSON) {
+        out_mem(&out, "{\"message\": ", 12);
+        json_string(&out, msg);
+        out_mem(&out, "}\n", 2);
+    } else {
+        out_mem(&out, msg, strlen(msg));
+        out_mem(&out, "\n", 1);
+    }
+    out_close(&out);
+    Repeats = 0;
+}
@@ -0,0 +1,29 @@
+/* diag.h
+ *
+ * Diagnostics. Messages are collected in each compilation's buffer and
+ * written to stderr in bulk, as text or as one JSON object a line. A
+ * message repeating one already given about the same line is counted but
+ * not shown, only counted for a note at the end of the run, and after
+ * Max_errors errors the compilation gives up: the lexer reports the end of
+ * the input from then on.
+ */
+#ifndef DIAG_H
+#define DIAG_H
+
+#include "lex.h"
+
+#define DIAG_MAX    128     /* longest message */
+
+typedef enum {
+    DIAG_TEXT,              /* file:line: message */
+    DIAG_JSON,              /* {"file": ..., "line": ..., "message": ...} */
+} diag_format_t;
+
+extern diag_format_t Diag_format;
+extern int Max_errors;      /* 0 for no limit */
+
+/* in diag.c; yyerror() is declared in lex.h */
+void diag_close(compiler_t *c);
+void diag_summary(void);
+
+#endif /* DIAG_H */
@@ -0,0 +1,133 @@
+/* emit.c
+ *
+ * Print quads as the two-address text the code generators used to print
+ * directly: "t0 = a", "t0 += t1", "t0 *= t1". The text is formatted
+ * straight into an output buffer (see out.h), without going through stdio.
+ * Or, depending on the back end picked, evaluate them and print the value,
+ * or write them out in binary.
+ */
+
+#include "ir.h"
+#include "vm.h"
+#include "jit.h"
+#include "batch.h"
+#include "flat.h"
+#include "timing.h"
+#include "scratch.h"
+
+backend_t Backend = BACKEND_TEXT;
+
+static _Thread_local vm_prog_t Prog;
+static _Thread_local jit_t Jit;
+
+static void release(void)
+{
+    vm_free(&Prog);
+    jit_free(&Jit);
+}
+
+static void operand(ir_t *ir, int opnd, out_t *out)
+{
+    switch (OPND_KIND(opnd)) {
+        case OPND_TEMP:
+            out_mem(out, "t", 1);
+            out_ulong(out, OPND_INDEX(opnd));
+            break;
+        case OPND_NUM:
+            out_ulong(out, IR_NUM(ir, opnd));
+            break;
+        case OPND_ID:
+            out_mem(out, IR_SYM_NAME(ir, opnd), IR_SYM(ir, opnd)->len);
+            break;
+    }
+}
+
+void emit(ir_t *ir, out_t *out)
+{
+    /* A quad whose destination isn't one of its sources is printed as a
+     * move followed by the operation. Both operators commute, so when the
+     * destination is the second source the sources trade places.
+     */
+    static const char *const opname[] = {
+        [Q_ADD] = " += ",
+        [Q_MUL] = " *= ",
+    };
+    ir_quad_t *q;
+    int src1, src2;
+
+    for (q = ir->quads; q < ir->quads + ir->nquads; ++q) {
+        src1 = q->src1;
+        src2 = q->src2;
+        if (q->op != Q_MOVE && q->dst == src2) {
+            src2 = src1;
+            src1 = q->dst;
+        }
+
+        if (q->op == Q_MOVE || q->dst != src1) {
+            out_mem(out, "    ", 4);
+            operand(ir, q->dst, out);
+            out_mem(out, " = ", 3);
+            operand(ir, src1, out);
+            out_mem(out, "\n", 1);
+        }
+        if (q->op != Q_MOVE) {
+            out_mem(out, "    ", 4);
+            operand(ir, q->dst, out);
+            out_mem(out, opname[q->op], 4);
+            operand(ir, src2, out);
+            out_mem(out, "\n", 1);
+        }
+    }
+}
+
+void generate(compiler_t *c, ir_t *ir, bool clean)
+{
+    /* Hand a finished statement to the back end. The JIT leaves whatever
+     * it can't handle to the bytecode interpreter. A statement that had
+     * errors ("clean" is false) is printed but never run, since its code
+     * can read temporaries that were never set. Except over a table,
+     * where there's too much of it to hold, the output stays in the buffer
+     * until the caller calls out_sync(), so that it can be looked at first.
+     */
+    out_t *out = c->out;
+    jit_fn_t fn;
+    phase_t was = phase(PHASE_BACKEND);
+
+    switch (Backend) {
+        case BACKEND_TEXT:
+            emit(ir, out);
+            break;
+        case BACKEND_FLAT:
+            flat_write(ir, out);
+            break;
+        case BACKEND_BATCH:
+            if (clean) {
+                batch_run(ir, out);
+            }
+            break;
+        case BACKEND_JIT:
+            if (!clean) {
+                break;
+            }
+            scratch_atexit(release);
+            if ((fn = jit_compile(&Jit, ir))) {
+                out_ulong(out, fn(Vm_vars));
+                out_mem(out, "\n", 1);
+                break;
+            }
+            /* fall through */
+        case BACKEND_VM:
+            if (!clean) {
+                break;
+            }
+            scratch_atexit(release);
+            if (vm_compile(&Prog, ir)) {
+                out_ulong(out, vm_exec(&Prog, Vm_vars));
+                out_mem(out, "\n", 1);
+            } else if (ir->nquads) {
+                yyerror(c, "Expression too complicated to evaluate");
+            }
+            break;
+    }
+    phase(was);
+}
@@ -0,0 +1,265 @@
+/* files.c
+ *
+ * Compiling many files in one run, the code for each going to a file of
+ * its own: foo.e makes foo.e.out. Every file is a separate compilation
+ * with a compiler_t of its own, so the files are shared out among a pool
+ * of worker threads.
+ *
+ * The pool balances itself by work stealing. The files are sorted biggest
+ * first and dealt out round robin, so that each worker starts with a fair
+ * share in its own queue. A worker takes from the front of its own queue;
+ * once that's empty it steals from the back of the fullest queue left,
+ * which is where the smallest files are, so a thief never holds up the end
+ * of the run with a big one.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "lex.h"
+#include "ir.h"
+#include "parser.h"
+#include "timing.h"
+
+typedef struct {
+    const char *path;
+    off_t size;
+} job_t;
+
+typedef struct pool pool_t;
+
+typedef struct {
+    pool_t *pool;           /* the pool it's in */
+    int *jobs;              /* indexes into pool->jobs */
+    int head, tail;         /* jobs[head..tail-1] are still to do */
+    pthread_mutex_t lock;
+} queue_t;
+
+struct pool {
+    job_t *jobs;
+    queue_t *queues;        /* one per worker */
+    int nqueues;
+    int failed;             /* files with errors */
+    pthread_mutex_t lock;
+};
+
+static void *xmalloc(size_t size)
+{
+    void *p;
+
+    if (!(p = malloc(size ? size : 1))) {
+        fprintf(stderr, "Out of memory for file list\n");
+        exit(1);
+    }
+    return p;
+}
+
+static int bigger(const void *a, const void *b)
+{
+    off_t x = ((const job_t *)a)->size, y = ((const job_t *)b)->size;
+
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+static int take(queue_t *q, bool front)
+{
+    /* Take a job off the front or back of q: -1 if it's empty. */
+
+    int job = -1;
+
+    pthread_mutex_lock(&q->lock);
+    if (q->head < q->tail) {
+        job = front ? q->jobs[q->head++] : q->jobs[--q->tail];
+    }
+    pthread_mutex_unlock(&q->lock);
+    return job;
+}
+
+static int left(queue_t *q)
+{
+    /* How many jobs q has left. */
+
+    int n;
+
+    pthread_mutex_lock(&q->lock);
+    n = q->tail - q->head;
+    pthread_mutex_unlock(&q->lock);
+    return n;
+}
+
+static int steal(pool_t *pool)
+{
+    /* Take a job from the back of whichever queue in the pool has the most
+     * left. Another thief can get there first, in which case take() finds
+     * it empty and we look again.
+     */
+    int i, n, job, best, most;
+
+    do {
+        best = -1;
+        most = 0;
+        for (i = 0; i < pool->nqueues; ++i) {
+            if ((n = left(&pool->queues[i])) > most) {
+                most = n;
+                best = i;
+            }
+        }
+        if (best < 0) {
+            return -1;
+        }
+    } while ((job = take(&pool->queues[best], false)) < 0);
+    return job;
+}
+
+static char *read_file(const char *path, size_t *lenp)
+{
+    /* Read all of a file into memory; NULL if it can't be read. */
+
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    size_t len = 0;
+    ssize_t n;
+    char *buf;
+
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return NULL;
+    }
+    buf = xmalloc(st.st_size);
+    while (len < st.st_size
+           && (n = read(fd, buf + len, st.st_size - len)) > 0) {
+        len += n;
+    }
+    close(fd);
+    *lenp = len;
+    return buf;
+}
+
+static bool compile(const char *path)
+{
+    /* Compile one file; false if it couldn't be done cleanly. */
+
+    compiler_t c;
+    out_t out;
+    size_t len, plen = strlen(path);
+    char *buf, *name;
+    int fd, errors;
+
+    if (!(buf = read_file(path, &len))) {
+        perror(path);
+        return false;
+    }
+    name = xmalloc(plen + sizeof(".out"));
+    memcpy(name, path, plen);
+    memcpy(name + plen, ".out", sizeof(".out"));
+    if ((fd = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0666)) < 0) {
+        perror(name);
+        free(name);
+        free(buf);
+        return false;
+    }
+
+    out_open(&out, fd);
+    compiler_init(&c, &out);
+    c.filename = path;
+    lex_string(&c, buf, len, 1);
+    statements(&c);
+    out_close(&out);
+    merge_pressure(&c);
+    errors = c.nerrs;
+    compiler_free(&c);
+
+    close(fd);
+    free(name);
+    free(buf);
+    return errors == 0;
+}
+
+static void *worker(void *arg)
+{
+    queue_t *own = arg;
+    pool_t *pool = own->pool;
+    int job, errors = 0;
+
+    while ((job = take(own, true)) >= 0 || (job = steal(pool)) >= 0) {
+        if (!compile(pool->jobs[job].path)) {
+            ++errors;
+        }
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->failed += errors;
+    pthread_mutex_unlock(&pool->lock);
+    merge_timing();
+    return NULL;
+}
+
+int compile_files(char **paths, int npaths, int nthreads)
+{
+    /* Compile each of the files named in paths[] on nthreads threads, and
+     * return how many of them couldn't be read or had errors.
+     */
+    pool_t pool;
+    queue_t *q;
+    pthread_t *threads;
+    struct stat st;
+    int i;
+
+    if (nthreads > npaths) {
+        nthreads = npaths;
+    }
+    if (nthreads < 1) {
+        nthreads = 1;
+    }
+
+    pool.jobs = xmalloc(npaths * sizeof(job_t));
+    for (i = 0; i < npaths; ++i) {
+        pool.jobs[i].path = paths[i];
+        pool.jobs[i].size = stat(paths[i], &st) == 0 ? st.st_size : 0;
+    }
+    qsort(pool.jobs, npaths, sizeof(job_t), bigger);
+
+    pool.nqueues = nthreads;
+    pool.queues = xmalloc(nthreads * sizeof(queue_t));
+    for (i = 0; i < nthreads; ++i) {
+        q = &pool.queues[i];
+        q->pool = &pool;
+        q->jobs = xmalloc((npaths / nthreads + 1) * sizeof(int));
+        q->head = q->tail = 0;
+        pthread_mutex_init(&q->lock, NULL);
+    }
+    for (i = 0; i < npaths; ++i) {
+        q = &pool.queues[i % nthreads];
+        q->jobs[q->tail++] = i;
+    }
+
+    pool.failed = 0;
+    pthread_mutex_init(&pool.lock, NULL);
+
+    threads = xmalloc(nthreads * sizeof(pthread_t));
+    for (i = 0; i < nthreads; ++i) {
+        if (pthread_create(&threads[i], NULL, worker, &pool.queues[i]) != 0) {
+            fprintf(stderr, "Can't create worker thread\n");
+            exit(1);
+        }
+    }
+    for (i = 0; i < nthreads; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+
+    pthread_mutex_destroy(&pool.lock);
+    for (i = 0; i < pool.nqueues; ++i) {
+        pthread_mutex_destroy(&pool.queues[i].lock);
+        free(pool.queues[i].jobs);
+    }
+    free(pool.queues);
+    free(pool.jobs);
+    free(threads);
+    return pool.failed;
+}
@@ -0,0 +1,118 @@
+/* flat.c
+ *
+ * Writing a statement's quads as a flat record (see flat.h). The ir_t's
+ * symbol table can still hold identifiers the optimizer has done away
+ * with, so only the ones the quads use are copied into the record,
+ * numbered afresh in the order they're first used.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "flat.h"
+#include "scratch.h"
+
+static _Thread_local int *Local;    /* Local[sym]: its index in the record */
+static _Thread_local int *Used;     /* the syms in the record, in order */
+static _Thread_local int Maxsyms;
+
+static void release(void)
+{
+    free(Local);
+    free(Used);
+    Local = Used = NULL;
+    Maxsyms = 0;
+}
+
+static void number(ir_t *ir, int opnd, int *nsyms, uint32_t *ntext)
+{
+    /* Give opnd, if it's an identifier, a number within the record. Local[]
+     * is only believed when Used[] agrees, so it never has to be cleared.
+     */
+    int i = OPND_INDEX(opnd), n;
+
+    if (OPND_KIND(opnd) == OPND_ID
+            && ((n = Local[i]) >= *nsyms || Used[n] != i)) {
+        Used[n = (*nsyms)++] = i;
+        Local[i] = n;
+        *ntext += ir->syms[i].len;
+    }
+}
+
+static uint32_t local(int opnd)
+{
+    if (OPND_KIND(opnd) == OPND_ID) {
+        return OPND(OPND_ID, Local[OPND_INDEX(opnd)]);
+    }
+    return opnd;
+}
+
+void flat_write(ir_t *ir, out_t *out)
+{
+    flat_stmt_t s = { FLAT_MAGIC };
+    flat_quad_t *fq;
+    flat_sym_t *fs;
+    ir_quad_t *q;
+    uint32_t ntext = 0, off;
+    int nsyms = 0, i;
+    char *p;
+
+    if (ir->nquads == 0) {
+        return;
+    }
+    if (ir->nsyms > Maxsyms) {
+        scratch_atexit(release);
+        free(Local);
+        free(Used);
+        Maxsyms = ir->nsyms * 2;
+        Local = calloc(Maxsyms, sizeof(int));
+        Used = malloc(Maxsyms * sizeof(int));
+        if (!Local || !Used) {
+            fprintf(stderr, "Out of memory for flat output\n");
+            exit(1);
+        }
+    }
+
+    /* Number the identifiers first, to know how big the record is. */
+    for (q = ir->quads; q < ir->quads + ir->nquads; ++q) {
+        number(ir, q->src1, &nsyms, &ntext);
+        if (q->op != Q_MOVE) {
+            number(ir, q->src2, &nsyms, &ntext);
+        }
+    }
+
+    s.nquads = ir->nquads;
+    s.nconsts = ir->nconsts;
+    s.nsyms = nsyms;
+    s.ntext = ntext;
+    s.quads = off = sizeof(flat_stmt_t);
+    s.consts = off += ir->nquads * sizeof(flat_quad_t);
+    s.syms = off += ir->nconsts * sizeof(uint64_t);
+    s.text = off += nsyms * sizeof(flat_sym_t);
+    s.size = (off + ntext + 7) & ~7u;
+
+    p = out_reserve(out, s.size);
+    memset(p, 0, s.size);
+    memcpy(p, &s, sizeof(s));
+    fq = (flat_quad_t *)(p + s.quads);
+    for (q = ir->quads; q < ir->quads + ir->nquads; ++q, ++fq) {
+        fq->op = q->op;
+        fq->dst = q->dst;
+        fq->src1 = local(q->src1);
+        fq->src2 = q->op == Q_MOVE ? 0 : local(q->src2);
+    }
+    memcpy(p + s.consts, ir->consts, ir->nconsts * sizeof(uint64_t));
+    fs = (flat_sym_t *)(p + s.syms);
+    for (i = 0, off = 0; i < nsyms; ++i, off += fs->len, ++fs) {
+        fs->start = off;
+        fs->len = ir->syms[Used[i]].len;
+        memcpy(p + s.text + off, ir->text + ir->syms[Used[i]].start, fs->len);
+    }
+    out->len += s.size;
+}
+
+void flat_marker(out_t *out)
+{
+    flat_stmt_t s = { FLAT_MAGIC, sizeof(flat_stmt_t) };
+
+    out_mem(out, (const char *)&s, sizeof(s));
+}
@@ -0,0 +1,52 @@
+/* flat.h
+ *
+ * A binary form of the quads, for programs that would otherwise read the
+ * text back in and parse it again. Each statement is one record that
+ * holds everything it refers to, and every reference inside it is an
+ * offset from the start of the record, so a file of records can be mapped
+ * into memory and walked where it lies: no pointers to fix up, nothing to
+ * copy. Records are a multiple of eight bytes long, so in a mapped file
+ * every one of them is aligned. Numbers are in the machine's byte order.
+ *
+ * A record is a flat_stmt_t, then its quads, constants, symbols and the
+ * symbols' spellings, in that order. Operands are encoded as in ir.h, but
+ * a constant or identifier's index is into the record's own tables, not
+ * the compiler's. A record with no quads in it at all is a marker: in
+ * incremental mode (see incr.c) one ends the code for each snapshot.
+ */
+#ifndef FLAT_H
+#define FLAT_H
+
+#include <stdint.h>
+#include "ir.h"
+
+#define FLAT_MAGIC  0x54414c46u     /* "FLAT", read little-endian */
+
+typedef struct {
+    uint32_t magic;
+    uint32_t size;          /* of the whole record; the next one starts here */
+    uint32_t nquads, nconsts, nsyms, ntext;
+    uint32_t quads, consts, syms, text;     /* offsets of the tables */
+} flat_stmt_t;
+
+typedef struct {
+    uint32_t op;            /* a qop_t */
+    uint32_t dst, src1, src2;
+} flat_quad_t;
+
+typedef struct {
+    uint32_t start, len;    /* spelling, as an offset into the text */
+} flat_sym_t;
+
+#define FLAT_AT(s, off)     ((const char *)(s) + (off))
+#define FLAT_QUADS(s)       ((const flat_quad_t *)FLAT_AT(s, (s)->quads))
+#define FLAT_CONSTS(s)      ((const uint64_t *)FLAT_AT(s, (s)->consts))
+#define FLAT_SYMS(s)        ((const flat_sym_t *)FLAT_AT(s, (s)->syms))
+#define FLAT_TEXT(s)        FLAT_AT(s, (s)->text)
+#define FLAT_NEXT(s)        ((const flat_stmt_t *)FLAT_AT(s, (s)->size))
+
+/* in flat.c */
+void flat_write(ir_t *ir, out_t *out);
+void flat_marker(out_t *out);
+
+#endif /* FLAT_H */
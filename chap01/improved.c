@@ -1,136 +1,82 @@
 /* Revised parser */
 
 #include <stdio.h>
-#include <stdarg.h>
 #include <stdbool.h>
-#include "lex.h"
-
-
-
-void factor(void);
-void term(void);
-void expression(void);
-bool legal_lookahead(token_t first_arg,...);
-
-void statements(void)
+#include "sets.h"
+#include "parser.h"
+
+static void factor(compiler_t *c);
+static void binary(compiler_t *c, int min_prec);
+static void expression(compiler_t *c);
+
+/* Binary operators, indexed by token. A token with precedence 0 isn't a
+ * binary operator; higher numbers bind tighter. New operators and levels
+ * only need an entry here.
+ */
+static const int Prec[UNKNOWN] = {
+    [PLUS]  = 1,
+    [TIMES] = 2,
+};
+
+void improved_statements(compiler_t *c)
 {
     /* statements -> expression SEMI | expression SEMI statements */
-    while (! match(EOI)) {
-        expression();
+    while (! match(c, EOI)) {
+        expression(c);
 
-        if (match(SEMI)) {
-            advance();
+        if (match(c, SEMI)) {
+            advance(c);
         } else {
-            fprintf(stderr, "%d: Inserting missing semicolon\n", yylineno);
+            yyerror(c, "Inserting missing semicolon");
         }
     }
 }
 
-void expression(void)
+static void expression(compiler_t *c)
 {
-    /* expression -> term expression'
-     * expression' -> PLUS term expression' | epsilon */
-    if (! legal_lookahead(NUM_OR_ID, LP, 0)) {
-        return;
-    }
-
-    term();
-    while (match(PLUS)) {
-        advance();
-        term();
-    }
+    /* expression -> factor (binop factor)* */
+    binary(c, 1);
 }
 
-void term(void)
+static void binary(compiler_t *c, int min_prec)
 {
-    /* term -> factor term' 
-     * term' -> TIMES factor term'
-     *       |  epsilon
+    /* Precedence climbing: parse a factor, then absorb every operator that
+     * binds at least as tightly as "min_prec". The right operand of each one
+     * only takes operators that bind tighter still, which makes them all
+     * left associative. A plain operand costs one call here however many
+     * precedence levels there are.
      */
-    if (! legal_lookahead(NUM_OR_ID, LP, 0)) {
-        return;
-    }
+    int prec;
 
-    factor();
-    while (match(TIMES)) {
-        advance();
-        factor();
+    factor(c);
+    while ((prec = Prec[lookahead(c)]) >= min_prec) {
+        advance(c);
+        binary(c, prec + 1);
     }
 }
 
-void factor(void)
+static void factor(compiler_t *c)
 {
-    /* factor -> NUM_OR_ID
+    /* factor -> NUM
+     *        |  ID
      *        |  LP expression RP
      */
-    if (! legal_lookahead(NUM_OR_ID, LP, 0)) {
+    if (! legal_lookahead(c, first(FACTOR))) {
         return;
     }
 
-    if (match(NUM_OR_ID)) {
-        advance();
-    } else if (match(LP)) {
-        advance();
-        expression();
-        if (match(RP)) {
-            advance();
+    if (match(c, NUM) || match(c, ID)) {
+        advance(c);
+    } else if (match(c, LP)) {
+        advance(c);
+        expression(c);
+        if (match(c, RP)) {
+            advance(c);
         } else {
-            fprintf(stderr, "%d: Mismatched parenthesis\n", yylineno);
-        }
-    } else {
-        fprintf(stderr, "%d: Number of identifier expected\n", yylineno);
-    }
-
-}
-
-#define MAXFIRST 16
-#define SYNCH   SEMI
-bool legal_lookahead(token_t first_arg,...)
-{
-    /* simple error detection and recovery. Arguments are a 0-terminated list
-     * of those token that can legitimately come next in the input. If the
-     * list is empty, the end of file must come next. Print an error message
-     * if necessary. Error recovery is performed by discarding all input
-     * symboals until one that's in the input list is found
-     *
-     * Return treu if there's no error or if we recovered from the error,
-     * false if we can't recover.
-     */
-    va_list args;
-    token_t tok;
-    token_t lookaheads[MAXFIRST], *p = lookaheads, *current;
-    int error_printed = 0;
-    int ret_val = 0;
-
-    va_start(args, first_arg);
-
-    if (! first_arg) {
-        if (match(EOF)) {
-            ret_val = true;
+            yyerror(c, "Mismatched parenthesis");
         }
     } else {
-        *p++ = first_arg;
-        while ((tok = va_arg(args, token_t)) && p < &lookaheads[MAXFIRST]) {
-            *++p = tok;
-        }
-        while (!match(SYNCH)) {
-            for(current = lookaheads; current < p; ++current) {
-                if (match(*current)) {
-                    ret_val = true;
-                    goto exit;
-                }
-            }
-
-            if (! error_printed) {
-                fprintf(stderr, "Line %d: Syntax error\n", yylineno);
-                error_printed = 1;
-            }
-
-            advance();
-        }
+        yyerror(c, "Number of identifier expected");
     }
 
-exit:
-    va_end(args);
-    return ret_val;
 }
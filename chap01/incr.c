@@ -0,0 +1,249 @@
+/* incr.c
+ *
+ * Incremental recompilation, for an editor that sends the whole buffer
+ * after every change. Standard input carries a series of snapshots, each
+ * one ended by a line holding just a form feed; the code for each is
+ * written to standard output, also followed by a form-feed line (or, for
+ * binary output, a marker record: see flat.h).
+ *
+ * A snapshot is cut into statements just past each semicolon, the same
+ * way parallel.c cuts chunks. The code generated for a statement depends
+ * only on its text, so every statement is looked up by its text in a hash
+ * table of the previous snapshot's statements, and only those that aren't
+ * there are lexed, parsed and compiled again; the rest have their old code
+ * copied. A statement that produced an error is never reused, so its
+ * diagnostics come out again with the right line numbers.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include "lex.h"
+#include "parser.h"
+#include "ir.h"
+#include "flat.h"
+
+typedef struct {
+    const char *text;       /* source, inside its snapshot */
+    size_t len;
+    uint64_t hash;
+    size_t code;            /* its code, as an offset into the snapshot's */
+    size_t codelen;         /* output                                     */
+    bool reusable;          /* false if compiling it reported errors */
+} stmt_t;
+
+typedef struct {
+    char *buf;              /* the snapshot itself */
+    size_t len;
+    out_t out;              /* code for all of it */
+    stmt_t *stmts;
+    int nstmts;
+    int *table;             /* open-addressed index into stmts, -1 empty */
+    int tablesize;          /* a power of two */
+} snapshot_t;
+
+static void *xrealloc(void *p, size_t size)
+{
+    if (!(p = realloc(p, size))) {
+        fprintf(stderr, "Out of memory for incremental state\n");
+        exit(1);
+    }
+    return p;
+}
+
+static uint64_t hash(const char *p, size_t len)
+{
+    /* FNV-1a */
+    uint64_t h = 0xcbf29ce484222325ULL;
+
+    while (len--) {
+        h = (h ^ (unsigned char)*p++) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static bool read_snapshot(snapshot_t *snap, char **line, size_t *linesize)
+{
+    /* Read lines up to a form-feed line or end of input, each into *line,
+     * which getline() grows as need be. Return false if there was nothing
+     * at all to read.
+     */
+    size_t max = 0;
+    ssize_t n;
+    bool any = false;
+
+    snap->buf = NULL;
+    snap->len = 0;
+    while ((n = getline(line, linesize, stdin)) >= 0) {
+        any = true;
+        if (strcmp(*line, "\f\n") == 0 || strcmp(*line, "\f") == 0) {
+            break;
+        }
+        if (snap->len + n > max) {
+            max = (snap->len + n) * 2;
+            snap->buf = xrealloc(snap->buf, max);
+        }
+        memcpy(snap->buf + snap->len, *line, n);
+        snap->len += n;
+    }
+    return any;
+}
+
+static bool blank(const char *p, const char *end)
+{
+    while (p < end && isspace((unsigned char)*p)) {
+        ++p;
+    }
+    return p == end;
+}
+
+static void split(snapshot_t *snap)
+{
+    /* Cut the snapshot into statements, each ending just past a semicolon
+     * or at the end of the buffer, and hash them. White space after the
+     * last semicolon goes with the last statement, rather than being a
+     * statement of its own that is never reused.
+     */
+    const char *p = snap->buf, *end = snap->buf + snap->len, *semi;
+    int max = 0;
+
+    snap->stmts = NULL;
+    snap->nstmts = 0;
+    while (p < end) {
+        if ((semi = memchr(p, ';', end - p)) && blank(semi + 1, end)) {
+            semi = NULL;
+        }
+        if (snap->nstmts == max) {
+            max = max ? max * 2 : 256;
+            snap->stmts = xrealloc(snap->stmts, max * sizeof(stmt_t));
+        }
+        snap->stmts[snap->nstmts].text = p;
+        snap->stmts[snap->nstmts].len = (semi ? semi + 1 : end) - p;
+        snap->stmts[snap->nstmts].hash =
+                hash(p, snap->stmts[snap->nstmts].len);
+        snap->stmts[snap->nstmts].reusable = false;
+        p += snap->stmts[snap->nstmts++].len;
+    }
+}
+
+static stmt_t *lookup(snapshot_t *snap, stmt_t *stmt)
+{
+    int slot, i;
+
+    if (!snap->table) {
+        return NULL;
+    }
+    slot = stmt->hash & (snap->tablesize - 1);
+    while ((i = snap->table[slot]) >= 0) {
+        if (snap->stmts[i].hash == stmt->hash && snap->stmts[i].len == stmt->len
+                && memcmp(snap->stmts[i].text, stmt->text, stmt->len) == 0) {
+            return &snap->stmts[i];
+        }
+        slot = (slot + 1) & (snap->tablesize - 1);
+    }
+    return NULL;
+}
+
+static void index_stmts(snapshot_t *snap)
+{
+    /* Build the hash table used to find this snapshot's statements from the
+     * next one. Only statements that compiled cleanly go in, and only the
+     * first of several with the same text.
+     */
+    int i, slot;
+
+    for (snap->tablesize = 16; snap->tablesize < 2 * snap->nstmts;) {
+        snap->tablesize *= 2;
+    }
+    snap->table = xrealloc(NULL, snap->tablesize * sizeof(int));
+    memset(snap->table, -1, snap->tablesize * sizeof(int));
+
+    for (i = 0; i < snap->nstmts; ++i) {
+        if (snap->stmts[i].reusable && !lookup(snap, &snap->stmts[i])) {
+            slot = snap->stmts[i].hash & (snap->tablesize - 1);
+            while (snap->table[slot] >= 0) {
+                slot = (slot + 1) & (snap->tablesize - 1);
+            }
+            snap->table[slot] = i;
+        }
+    }
+}
+
+static void compile(compiler_t *c, stmt_t *stmt, int lineno)
+{
+    /* Run one statement through the parser and note whether it can be
+     * reused.
+     */
+    int errors = c->nerrs;
+
+    lex_string(c, stmt->text, stmt->len, lineno);
+    statements(c);
+    stmt->reusable = c->nerrs == errors;
+}
+
+static void release(snapshot_t *snap)
+{
+    free(snap->stmts);
+    free(snap->table);
+    free(snap->buf);
+    free(snap->out.buf);
+}
+
+void incremental_statements(compiler_t *c)
+{
+    snapshot_t old = { 0 }, new;
+    out_t *out = c->out;
+    struct iovec iov;
+    stmt_t *stmt, *prev;
+    int i, lineno;
+    const char *p;
+    char *line = NULL;
+    size_t linesize = 0;
+
+    while (read_snapshot(&new, &line, &linesize)) {
+        split(&new);
+        new.table = NULL;
+        out_open(&new.out, -1);
+        out_reserve(&new.out, old.out.len + sizeof(flat_stmt_t));
+        c->out = &new.out;
+        lineno = 1;
+
+        for (i = 0; i < new.nstmts; ++i) {
+            stmt = &new.stmts[i];
+            stmt->code = new.out.len;
+            if ((prev = lookup(&old, stmt))) {
+                out_mem(&new.out, old.out.buf + prev->code, prev->codelen);
+                stmt->reusable = true;
+            } else {
+                compile(c, stmt, lineno);
+            }
+            stmt->codelen = new.out.len - stmt->code;
+
+            for (p = stmt->text; (p = memchr(p, '\n',
+                                  stmt->text + stmt->len - p)); ++p) {
+                ++lineno;
+            }
+        }
+
+        /* The snapshot's code goes out straight from where it was put
+         * together, end marker and all, rather than being copied again.
+         */
+        if (Backend == BACKEND_FLAT) {
+            flat_marker(&new.out);
+        } else {
+            out_mem(&new.out, "\f\n", 2);
+        }
+        c->out = out;
+        iov.iov_base = new.out.buf;
+        iov.iov_len = new.out.len;
+        out_writev(out, &iov, 1);
+
+        index_stmts(&new);
+        release(&old);
+        old = new;
+    }
+    release(&old);
+    free(line);
+}
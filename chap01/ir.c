@@ -0,0 +1,144 @@
+/* ir.c
+ *
+ * Building the quad array. Everything grows by doubling; ir_clear() starts
+ * a new statement without giving any memory back.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "lex.h"
+#include "ir.h"
+
+static void *grow(void *buf, int *max, size_t size, int need)
+{
+    if (need <= *max) {
+        return buf;
+    }
+    while (*max < need) {
+        *max = *max ? *max * 2 : 64;
+    }
+    if (!(buf = realloc(buf, *max * size))) {
+        fprintf(stderr, "Out of memory for intermediate code\n");
+        exit(1);
+    }
+    return buf;
+}
+
+void ir_init(ir_t *ir)
+{
+    memset(ir, 0, sizeof(*ir));
+}
+
+void ir_free(ir_t *ir)
+{
+    free(ir->quads);
+    free(ir->consts);
+    free(ir->text);
+    free(ir->syms);
+    free(ir->hash);
+    memset(ir, 0, sizeof(*ir));
+}
+
+static unsigned hash(const char *name, int len);
+
+void ir_clear(ir_t *ir)
+{
+    /* Start a new statement. Its identifiers start afresh too, so that the
+     * symbol table holds one statement's worth rather than the whole
+     * input's. Each symbol's slot in the hash table is found and emptied,
+     * rather than clearing a table made big by some long statement.
+     */
+    int i, slot;
+
+    for (i = 0; i < ir->nsyms; ++i) {
+        slot = hash(ir->text + ir->syms[i].start, ir->syms[i].len)
+               & (ir->hashsize - 1);
+        while (ir->hash[slot] != i) {
+            slot = (slot + 1) & (ir->hashsize - 1);
+        }
+        ir->hash[slot] = -1;
+    }
+    ir->nquads = 0;
+    ir->nconsts = 0;
+    ir->nsyms = 0;
+    ir->ntext = 0;
+}
+
+int ir_num(ir_t *ir, unsigned long value)
+{
+    ir->consts = grow(ir->consts, &ir->maxconsts, sizeof(unsigned long),
+                      ir->nconsts + 1);
+    ir->consts[ir->nconsts] = value;
+    return OPND(OPND_NUM, ir->nconsts++);
+}
+
+static unsigned hash(const char *name, int len)
+{
+    unsigned h = 2166136261u;   /* FNV-1a */
+
+    while (--len >= 0) {
+        h = (h ^ (unsigned char)*name++) * 16777619u;
+    }
+    return h;
+}
+
+static void rehash(ir_t *ir)
+{
+    int i, slot;
+
+    free(ir->hash);
+    ir->hash = grow(NULL, &ir->hashsize, sizeof(int), ir->hashsize + 1);
+    memset(ir->hash, -1, ir->hashsize * sizeof(int));
+
+    for (i = 0; i < ir->nsyms; ++i) {
+        slot = hash(ir->text + ir->syms[i].start, ir->syms[i].len)
+               & (ir->hashsize - 1);
+        while (ir->hash[slot] >= 0) {
+            slot = (slot + 1) & (ir->hashsize - 1);
+        }
+        ir->hash[slot] = i;
+    }
+}
+
+int ir_id(ir_t *ir, const char *name, int len)
+{
+    /* Return the operand for an identifier, entering it in the symbol table
+     * the first time it's seen.
+     */
+    int slot, i;
+
+    if (2 * (ir->nsyms + 1) > ir->hashsize) {
+        rehash(ir);
+    }
+
+    slot = hash(name, len) & (ir->hashsize - 1);
+    while ((i = ir->hash[slot]) >= 0) {
+        if (ir->syms[i].len == len
+                && memcmp(ir->text + ir->syms[i].start, name, len) == 0) {
+            return OPND(OPND_ID, i);
+        }
+        slot = (slot + 1) & (ir->hashsize - 1);
+    }
+
+    ir->text = grow(ir->text, &ir->maxtext, 1, ir->ntext + len);
+    memcpy(ir->text + ir->ntext, name, len);
+    ir->syms = grow(ir->syms, &ir->maxsyms, sizeof(ir_sym_t), ir->nsyms + 1);
+    ir->syms[ir->nsyms].start = ir->ntext;
+    ir->syms[ir->nsyms].len = len;
+    ir->ntext += len;
+    ir->hash[slot] = ir->nsyms;
+    return OPND(OPND_ID, ir->nsyms++);
+}
+
+void ir_gen(ir_t *ir, qop_t op, int dst, int src1, int src2)
+{
+    ir_quad_t *q;
+
+    ir->quads = grow(ir->quads, &ir->maxquads, sizeof(ir_quad_t),
+                     ir->nquads + 1);
+    q = &ir->quads[ir->nquads++];
+    q->op = op;
+    q->dst = dst;
+    q->src1 = src1;
+    q->src2 = src2;
+}
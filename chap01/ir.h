@@ -0,0 +1,94 @@
+/* ir.h
+ *
+ * Three-address code kept in memory as an array of quads, so that it can
+ * be optimized or handed to a back end other than the text emitter.
+ */
+#ifndef IR_H
+#define IR_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "lex.h"
+
+/* An operand is an int holding its kind in the low two bits and an index
+ * above them: a temporary's number, or an index into the statement's
+ * constant pool or symbol table.
+ */
+#define OPND_TEMP   0
+#define OPND_NUM    1
+#define OPND_ID     2
+
+#define OPND(kind, index)   ((index) << 2 | (kind))
+#define OPND_KIND(opnd)     ((opnd) & 3)
+#define OPND_INDEX(opnd)    ((opnd) >> 2)
+#define TEMP(n)             OPND(OPND_TEMP, n)
+
+typedef enum {
+    Q_MOVE,     /* dst = src1        */
+    Q_ADD,      /* dst = src1 + src2 */
+    Q_MUL,      /* dst = src1 * src2 */
+} qop_t;
+
+typedef struct {
+    int op;
+    int dst, src1, src2;
+} ir_quad_t;
+
+typedef struct {
+    int start, len;         /* spelling, as an offset into ir_t.text */
+} ir_sym_t;
+
+typedef struct {
+    ir_quad_t *quads;          /* code for the current statement */
+    int nquads, maxquads;
+    unsigned long *consts;  /* constant pool, also per statement */
+    int nconsts, maxconsts;
+
+    /* Identifiers, interned for the current statement. */
+    char *text;
+    int ntext, maxtext;
+    ir_sym_t *syms;
+    int nsyms, maxsyms;
+    int *hash;              /* open-addressed index into symbols, -1 empty */
+    int hashsize;
+} ir_t;
+
+#define IR_NUM(ir, opnd)        ((ir)->consts[OPND_INDEX(opnd)])
+#define IR_SYM(ir, opnd)        (&(ir)->syms[OPND_INDEX(opnd)])
+#define IR_SYM_NAME(ir, opnd)   ((ir)->text + IR_SYM(ir, opnd)->start)
+
+/* in ir.c */
+void ir_init(ir_t *ir);
+void ir_free(ir_t *ir);
+void ir_clear(ir_t *ir);
+int ir_num(ir_t *ir, unsigned long value);
+int ir_id(ir_t *ir, const char *name, int len);
+void ir_gen(ir_t *ir, qop_t op, int dst, int src1, int src2);
+
+/* in opt.c */
+extern int Optlevel;
+void optimize(ir_t *ir);
+
+/* in peep.c */
+void peephole(ir_t *ir);
+
+typedef enum {
+    BACKEND_TEXT,           /* print the code */
+    BACKEND_VM,             /* run it on the bytecode interpreter */
+    BACKEND_JIT,            /* run it as machine code */
+    BACKEND_BATCH,          /* run it over every row of a table */
+    BACKEND_FLAT,           /* write it as binary records (see flat.h) */
+} backend_t;
+
+/* in emit.c */
+extern backend_t Backend;
+void generate(compiler_t *c, ir_t *ir, bool clean);
+void emit(ir_t *ir, out_t *out);
+
+/* in name.c */
+int newtemp(compiler_t *c);
+void freetemp(compiler_t *c, int temp);
+void merge_pressure(compiler_t *c);
+void print_pressure(FILE *fp);
+
+#endif /* IR_H */
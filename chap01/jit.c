@@ -0,0 +1,260 @@
+/* jit.c
+ *
+ * An x86-64 back end. The temporaries of a statement live in registers,
+ *
+ *      t0  t1  t2  t3  t4  t5  t6
+ *      rax rcx rdx rsi r8  r9  r10
+ *
+ * with r11 as a scratch register for big constants and rdi pointing at the
+ * variable table, so an identifier is an operand in memory, [rdi + 8*slot].
+ * A quad becomes at most three instructions, and the result is left in rax
+ * for the return. The code buffer is a memfd mapped twice, once writable
+ * and once executable, so no page is ever both, and compiling a statement
+ * takes no system calls once the buffer is big enough.
+ *
+ * jit_compile() returns NULL for a statement needing more temporaries than
+ * there are registers, and on other machines, so the caller can fall back
+ * to the bytecode interpreter.
+ */
+
+#define _GNU_SOURCE         /* for memfd_create() */
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "lex.h"
+#include "vm.h"
+#include "jit.h"
+
+#if defined(__x86_64__)
+
+#define NREGS       7           /* for temporaries */
+#define SCRATCH     11          /* r11 */
+#define VARS        7           /* rdi */
+#define QUAD_MAX    32          /* most bytes of code for one quad */
+
+static const unsigned char Reg[NREGS] = { 0, 1, 2, 6, 8, 9, 10 };
+
+static void byte(jit_t *jit, int b)
+{
+    jit->code[jit->len++] = b;
+}
+
+static void bytes(jit_t *jit, const void *p, size_t n)
+{
+    memcpy(jit->code + jit->len, p, n);
+    jit->len += n;
+}
+
+static void rex(jit_t *jit, int reg, int rm)
+{
+    /* REX.W, with the high bits of the ModRM reg and rm fields */
+
+    byte(jit, 0x48 | (reg >> 3) << 2 | rm >> 3);
+}
+
+static void rr(jit_t *jit, const char *op, int reg, int rm)
+{
+    /* An instruction (one or two opcode bytes) on two registers. */
+
+    rex(jit, reg, rm);
+    bytes(jit, op, strlen(op));
+    byte(jit, 0xc0 | (reg & 7) << 3 | (rm & 7));
+}
+
+static void rm(jit_t *jit, const char *op, int reg, int slot)
+{
+    /* An instruction with a variable for its memory operand. */
+
+    int32_t disp = slot * 8;
+
+    rex(jit, reg, VARS);
+    bytes(jit, op, strlen(op));
+    byte(jit, 0x80 | (reg & 7) << 3 | VARS);
+    bytes(jit, &disp, 4);
+}
+
+static bool small(unsigned long value)
+{
+    return (long)value == (int32_t)value;
+}
+
+static void load_imm(jit_t *jit, int reg, unsigned long value)
+{
+    int32_t imm = value;
+
+    if (small(value)) {
+        rex(jit, 0, reg);                       /* mov r64, imm32 */
+        byte(jit, 0xc7);
+        byte(jit, 0xc0 | (reg & 7));
+        bytes(jit, &imm, 4);
+    } else {
+        rex(jit, 0, reg);                       /* movabs r64, imm64 */
+        byte(jit, 0xb8 | (reg & 7));
+        bytes(jit, &value, 8);
+    }
+}
+
+static void load(jit_t *jit, ir_t *ir, int reg, int opnd)
+{
+    switch (OPND_KIND(opnd)) {
+        case OPND_TEMP:
+            if (Reg[OPND_INDEX(opnd)] != reg) {
+                rr(jit, "\x89", Reg[OPND_INDEX(opnd)], reg);   /* mov */
+            }
+            break;
+        case OPND_NUM:
+            load_imm(jit, reg, IR_NUM(ir, opnd));
+            break;
+        default:
+            rm(jit, "\x8b", reg,                                /* mov */
+               vm_var(IR_SYM_NAME(ir, opnd), IR_SYM(ir, opnd)->len));
+            break;
+    }
+}
+
+static void binary(jit_t *jit, ir_t *ir, qop_t op, int reg, int opnd)
+{
+    /* reg op= opnd */
+
+    unsigned long value;
+    int32_t imm;
+
+    switch (OPND_KIND(opnd)) {
+        case OPND_TEMP:
+            if (op == Q_ADD) {
+                rr(jit, "\x01", Reg[OPND_INDEX(opnd)], reg);    /* add */
+            } else {
+                rr(jit, "\x0f\xaf", reg, Reg[OPND_INDEX(opnd)]); /* imul */
+            }
+            break;
+        case OPND_NUM:
+            if (!small(value = IR_NUM(ir, opnd))) {
+                load_imm(jit, SCRATCH, value);
+                if (op == Q_ADD) {
+                    rr(jit, "\x01", SCRATCH, reg);
+                } else {
+                    rr(jit, "\x0f\xaf", reg, SCRATCH);
+                }
+                break;
+            }
+            imm = value;
+            if (op == Q_ADD) {
+                rr(jit, "\x81", 0, reg);                /* add r64, imm32 */
+            } else {
+                rr(jit, "\x69", reg, reg);              /* imul r64, imm32 */
+            }
+            bytes(jit, &imm, 4);
+            break;
+        default:
+            rm(jit, op == Q_ADD ? "\x03" : "\x0f\xaf", reg,
+               vm_var(IR_SYM_NAME(ir, opnd), IR_SYM(ir, opnd)->len));
+            break;
+    }
+}
+
+static bool reserve(jit_t *jit, size_t need)
+{
+    /* Make sure the buffer holds at least "need" bytes. */
+
+    int fd;
+
+    if (need <= jit->size) {
+        return true;
+    }
+    jit_free(jit);
+
+    jit->size = (need + 0xffff) & ~(size_t)0xffff;
+    if ((fd = memfd_create("jit", 0)) < 0) {
+        return false;
+    }
+    if (ftruncate(fd, jit->size) == 0) {
+        jit->code = mmap(NULL, jit->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                         fd, 0);
+        jit->exec = mmap(NULL, jit->size, PROT_READ | PROT_EXEC, MAP_SHARED,
+                         fd, 0);
+    }
+    close(fd);
+
+    if (!jit->code || jit->code == MAP_FAILED
+            || !jit->exec || jit->exec == MAP_FAILED) {
+        if (jit->code == MAP_FAILED) {
+            jit->code = NULL;
+        }
+        if (jit->exec == MAP_FAILED) {
+            jit->exec = NULL;
+        }
+        jit_free(jit);
+        return false;
+    }
+    return true;
+}
+
+jit_fn_t jit_compile(jit_t *jit, ir_t *ir)
+{
+    ir_quad_t *q;
+    int dst, src1, src2, t;
+
+    if (ir->nquads == 0) {
+        return NULL;
+    }
+    for (q = ir->quads; q < ir->quads + ir->nquads; ++q) {
+        if (OPND_INDEX(q->dst) >= NREGS
+                || (OPND_KIND(q->src1) == OPND_TEMP
+                    && OPND_INDEX(q->src1) >= NREGS)
+                || (q->op != Q_MOVE && OPND_KIND(q->src2) == OPND_TEMP
+                    && OPND_INDEX(q->src2) >= NREGS)) {
+            return NULL;
+        }
+    }
+    if (!reserve(jit, (ir->nquads + 1) * QUAD_MAX)) {
+        return NULL;
+    }
+
+    jit->len = 0;
+    for (q = ir->quads; q < ir->quads + ir->nquads; ++q) {
+        dst = Reg[OPND_INDEX(q->dst)];
+        if (q->op == Q_MOVE) {
+            load(jit, ir, dst, q->src1);
+            continue;
+        }
+
+        /* Get source 1 into the destination without clobbering source 2,
+         * as in vm_compile().
+         */
+        src1 = q->src1;
+        src2 = q->src2;
+        if (OPND_KIND(src1) != OPND_TEMP || src2 == q->dst) {
+            t = src1;
+            src1 = src2;
+            src2 = t;
+        }
+        load(jit, ir, dst, src1);
+        binary(jit, ir, q->op, dst, src2);
+    }
+    load(jit, ir, 0, ir->quads[ir->nquads - 1].dst);    /* mov rax, result */
+    byte(jit, 0xc3);                                    /* ret */
+
+    return (jit_fn_t)jit->exec;
+}
+
+#else
+
+jit_fn_t jit_compile(jit_t *jit, ir_t *ir)
+{
+    return NULL;
+}
+
+#endif /* __x86_64__ */
+
+void jit_free(jit_t *jit)
+{
+    if (jit->code) {
+        munmap(jit->code, jit->size);
+    }
+    if (jit->exec) {
+        munmap(jit->exec, jit->size);
+    }
+    memset(jit, 0, sizeof(*jit));
+}
@@ -0,0 +1,25 @@
+/* jit.h
+ *
+ * Compiling a statement to x86-64 machine code. The code is a function
+ * taking the variable table (see vm.h) and returning the statement's
+ * value.
+ */
+#ifndef JIT_H
+#define JIT_H
+
+#include <stddef.h>
+#include "ir.h"
+
+typedef unsigned long (*jit_fn_t)(const unsigned long *vars);
+
+typedef struct {
+    unsigned char *code;    /* where the code is written */
+    unsigned char *exec;    /* the same memory, mapped executable */
+    size_t len, size;
+} jit_t;
+
+/* in jit.c */
+jit_fn_t jit_compile(jit_t *jit, ir_t *ir);
+void jit_free(jit_t *jit);
+
+#endif /* JIT_H */
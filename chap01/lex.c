@@ -1,30 +1,171 @@
 #include "lex.h"
+#include "parser.h"
+#include "diag.h"
+#include "timing.h"
 #include <stdio.h>
 #include <ctype.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <stdlib.h>
 
-char *yytext = "";   /* lexeme (not '\0' terminated.) */
-int yyleng   = 0;    /* lexeme length                 */
-int yylineno = 0;    /* input line number             */
+/* All of the lexer's state is in the compiler_t, so that several
+ * compilations can go on at once (see parallel.c and files.c).
+ */
 
-token_t lex(void)
+void compiler_init(compiler_t *c, out_t *out)
+{
+    /* Start a compilation reading standard input and writing to "out". */
+
+    memset(c, 0, sizeof(*c));
+    c->text = "";
+    c->lookahead = UNKNOWN;
+    c->out = out;
+}
+
+void compiler_free(compiler_t *c)
+{
+    diag_close(c);
+    if (c->parser_free) {
+        c->parser_free(c->parser);
+    }
+    free(c->line);
+    free(c->temps);
+    free(c->pressure);
+    memset(c, 0, sizeof(*c));
+}
+
+static bool get_line(compiler_t *c)
+{
+    /* Read the next input line into c->line, without its newline. Lines
+     * come from the string given to lex_string(), if any, or else from
+     * standard input. Return false at end of input.
+     */
+    const char *nl;
+    ssize_t len;
+
+    if (c->src) {
+        if (c->src >= c->src_end) {
+            return false;
+        }
+        nl = memchr(c->src, '\n', c->src_end - c->src);
+        len = (nl ? nl : c->src_end) - c->src;
+        if (len + 1 > c->line_size) {
+            c->line_size = len + 1 > 128 ? len + 1 : 128;
+            if (!(c->line = realloc(c->line, c->line_size))) {
+                fprintf(stderr, "%d: Out of memory for input line\n",
+                        c->lineno);
+                exit(1);
+            }
+        }
+        memcpy(c->line, c->src, len);
+        c->line[len] = '\0';
+        c->src += nl ? len + 1 : len;
+        return true;
+    }
+
+    if ((len = getline(&c->line, &c->line_size, stdin)) < 0) {
+        return false;
+    }
+    if (len > 0 && c->line[len - 1] == '\n') {
+        c->line[len - 1] = '\0';
+    }
+    return true;
+}
+
+void lex_string(compiler_t *c, const char *buf, size_t len, int lineno)
+{
+    /* Take input from the "len" characters at "buf" instead of standard
+     * input, numbering the first line "lineno", and start over with a fresh
+     * lookahead. The characters must stay put until the lexer reaches the
+     * end of them.
+     */
+    c->src = buf;
+    c->src_end = buf + len;
+    c->text = "";
+    c->leng = 0;
+    c->lineno = lineno - 1;
+    c->lookahead = UNKNOWN;
+}
+
+void lex_skip(compiler_t *c, char *p)
+{
+    /* Go on lexing from "p", which must be in the current input line,
+     * forgetting the lookahead. The caller has dealt with everything
+     * before it some other way.
+     */
+    c->text = p;
+    c->leng = 0;
+    c->lookahead = UNKNOWN;
+}
+
+static unsigned long eight_digits(const char *p)
+{
+    /* Convert eight ASCII digits to their value with three multiplies
+     * instead of eight. The digits are loaded as one little-endian word, so
+     * p[0] is in the low byte, and each step merges neighbouring fields:
+     * 1-digit fields into 2-digit ones, then 2 into 4, then 4 into 8.
+     */
+    uint64_t val;
+
+    memcpy(&val, p, sizeof(val));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    val = __builtin_bswap64(val);
+#endif
+    val -= 0x3030303030303030ULL;
+    val = (val * 10) + (val >> 8);
+    val = (((val & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+           (((val >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32))))
+          >> 32;
+    return val;
+}
+
+static bool number(const char *p, int len, unsigned long *valp)
+{
+    /* Decode a run of "len" decimal digits, eight at a time while there are
+     * that many left. Return false if the value doesn't fit in an unsigned
+     * long.
+     */
+    unsigned long val = 0;
+    bool over = false;
+
+    for (; len >= 8; p += 8, len -= 8) {
+        over |= __builtin_mul_overflow(val, 100000000UL, &val);
+        over |= __builtin_add_overflow(val, eight_digits(p), &val);
+    }
+    for (; len > 0; --len) {
+        over |= __builtin_mul_overflow(val, 10UL, &val);
+        over |= __builtin_add_overflow(val, (unsigned long)(*p++ - '0'), &val);
+    }
+    *valp = val;
+    return !over;
+}
+
+token_t lex(compiler_t *c)
 {
-    static char input_buffer[128];
     char *current;
 
-    current = yytext + yyleng;  /* skip current lexeme */
+    if (c->stopped) {
+        c->text = "";
+        c->leng = 0;
+        return EOI;
+    }
+
+    current = c->text + c->leng;    /* skip current lexeme */
 
     while (true) {
         while (*current == '\0') {
             /* Get new lines, skipping any leading white space on the line until a
              * nonblank line is found. 
              */ 
-            current = input_buffer;
-            if (!gets(input_buffer)) {
-                *current = '\0';
+            if (!get_line(c)) {
+                c->text = "";
+                c->leng = 0;
                 return EOI;
             }
-            ++yylineno;
+            current = c->line;
+            ++c->lineno;
             while (isspace(*current)) {
                 ++current;
             }
@@ -33,8 +174,8 @@ token_t lex(void)
         for (; *current; ++current) {
             /* Get the next token */
 
-            yytext = current;
-            yyleng = 1;
+            c->text = current;
+            c->leng = 1;
 
             switch (*current) {
                 case EOF: 
@@ -62,15 +203,32 @@ token_t lex(void)
                     break;
 
                 default:
-                    if (! isalnum(*current)) {
-                        fprintf(stderr, "Ignoring illegal input <%c>\n",
-                                *current);
-                    } else {
+                    if (isdigit(*current)) {
+                        while (isdigit(*current)) {
+                            ++current;
+                        }
+                        c->leng = current - c->text;
+                        if (!number(c->text, c->leng, &c->lval)) {
+                            yyerror(c, "Number too big: %.*s", c->leng, c->text);
+                            c->lval = ULONG_MAX;
+                        }
+                        if (isalpha(*current)) {
+                            /* Not a number followed by a name: one bad token. */
+                            while (isalnum(*current)) {
+                                ++current;
+                            }
+                            c->leng = current - c->text;
+                            yyerror(c, "Malformed number <%.*s>", c->leng, c->text);
+                        }
+                        return NUM;
+                    } else if (isalpha(*current)) {
                         while (isalnum(*current)) {
                             ++current;
                         }
-                        yyleng = current - yytext;
-                        return NUM_OR_ID;
+                        c->leng = current - c->text;
+                        return ID;
+                    } else {
+                        yyerror(c, "Ignoring illegal input <%c>", *current);
                     }
                     break;
             } /* end of switch */
@@ -78,21 +236,104 @@ token_t lex(void)
     } /* end of while */
 }
 
-static token_t Lookahead = UNKNOWN;    /* look ahead token */
+token_t lex_sync(compiler_t *c, unsigned int tokens)
+{
+    /* Error recovery: throw away the input after the current token up to
+     * the next one in "tokens" (a bit for each token_t, as in sets.h), and
+     * return it, or EOI if there isn't one. The tokens in between aren't
+     * lexed: each line is searched with strcspn() for a character one of
+     * the wanted tokens can start with, so what's skipped, illegal
+     * characters included, costs a pass of the string functions over it
+     * and nothing more. A letter or digit inside a name or number doesn't
+     * count.
+     */
+    static const char *const starts[UNKNOWN] = {
+        [SEMI]  = ";",
+        [PLUS]  = "+",
+        [TIMES] = "*",
+        [LP]    = "(",
+        [RP]    = ")",
+        [NUM]   = "0123456789",
+        [ID]    = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ",
+    };
+    char accept[128] = "";
+    phase_t was;
+    char *p;
+    int t;
+
+    if (c->stopped) {
+        return lookahead(c);
+    }
+    for (t = 0; t < UNKNOWN; ++t) {
+        if ((tokens >> t & 1) && starts[t]) {
+            strcat(accept, starts[t]);
+        }
+    }
+
+    was = phase(PHASE_LEX);
+    for (p = c->text + c->leng; ; ) {
+        p += strcspn(p, accept);
+        if (*p == '\0') {
+            if (!get_line(c)) {
+                c->text = p;
+                c->leng = 0;
+                break;
+            }
+            ++c->lineno;
+            p = c->line;
+        } else if (isalnum((unsigned char)*p) && p > c->line
+                   && isalnum((unsigned char)p[-1])) {
+            while (isalnum((unsigned char)*p)) {
+                ++p;
+            }
+        } else {
+            c->text = p;
+            c->leng = 0;
+            break;
+        }
+    }
+    c->lookahead = UNKNOWN;
+    phase(was);
+    return lookahead(c);
+}
+
+void lex_statements(compiler_t *c)
+{
+    /* Just read the tokens, for measuring the lexer by itself (-P lex). */
 
-bool match(token_t token)
+    while (!match(c, EOI)) {
+        advance(c);
+    }
+}
+
+token_t lookahead(compiler_t *c)
 {
-    /* Return true if "token" matches the current lookahead symbol */
+    /* Return the current lookahead symbol without consuming it */
 
-    if (Lookahead == UNKNOWN) {
-        Lookahead = lex();
+    phase_t was;
+
+    if (c->lookahead == UNKNOWN) {
+        was = phase(PHASE_LEX);
+        c->lookahead = lex(c);
+        phase(was);
     }
 
-    return token == Lookahead;
+    return c->lookahead;
+}
+
+bool match(compiler_t *c, token_t token)
+{
+    /* Return true if "token" matches the current lookahead symbol */
+
+    return token == lookahead(c);
 }
 
-void advance()
+void advance(compiler_t *c)
 {
     /* Advance the lookahead to the next input symbol. */
-    Lookahead = lex();
+
+    phase_t was = phase(PHASE_LEX);
+
+    c->lookahead = lex(c);
+    phase(was);
 }
@@ -1,3 +1,12 @@
+#ifndef LEX_H
+#define LEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "out.h"
+
 typedef enum {
     EOI       = 0, /* end of input */
     SEMI      = 1, /* ; */
@@ -5,10 +14,62 @@ typedef enum {
     TIMES     = 3, /* * */
     LP        = 4, /* ( */
     RP        = 5, /* ) */
-    NUM_OR_ID = 6, /* decimal number or identifier */
+    NUM       = 6, /* decimal number */
+    ID        = 7, /* identifier */
     UNKNOWN,
 } token_t;
 
-extern char *yytext;    /* in lex.c */
-extern int yyleng;
-extern int yylineno;
+#define DIAG_SEEN   8       /* messages per line remembered for repeats */
+
+/* Everything one compilation needs: where it is in the input, where its
+ * code goes, its errors, and its temporaries. Nothing else in the lexer or
+ * the parsers keeps state, so any number of compilations can be under way
+ * at once, on one thread or several, each with its own compiler_t handed
+ * down to whatever reads input, reports errors or allocates temporaries.
+ * Settings for the whole run (the parser and back end picked, the
+ * optimization level, memoizing, the error limit and format, -D values
+ * and the -T table) are globals, set before anything is compiled and only
+ * read after that.
+ */
+typedef struct {
+    char *text;             /* lexeme (not '\0' terminated) */
+    int leng;               /* lexeme length */
+    int lineno;             /* input line number */
+    unsigned long lval;     /* value of a NUM lexeme */
+    token_t lookahead;      /* UNKNOWN until it's been read */
+
+    char *line;             /* current input line */
+    size_t line_size;
+    const char *src;        /* in-memory input, or NULL for standard input */
+    const char *src_end;
+
+    out_t *out;             /* where the code generators write */
+    int nerrs;              /* errors reported by yyerror() */
+    const char *filename;   /* for messages, NULL for standard input */
+    out_t diag;             /* messages on their way to stderr (diag.c) */
+    uint32_t seen[DIAG_SEEN];   /* hashes of the messages about */
+    int nseen, seenline;        /* line seenline so far */
+    int repeats;            /* messages not shown for being repeats */
+    bool stopped;           /* too many errors: no more input */
+
+    void *parser;           /* a parser's own state, kept from one call */
+    void (*parser_free)(void *);    /* to the next; see retval.c */
+
+    int *temps;             /* temporaries: see name.c */
+    int tempp, ntemps, maxtemps, peak;
+    long *pressure;
+    int maxpressure;
+} compiler_t;
+
+void compiler_init(compiler_t *c, out_t *out);
+void compiler_free(compiler_t *c);
+token_t lex(compiler_t *c);
+bool match(compiler_t *c, token_t token);
+void advance(compiler_t *c);
+token_t lookahead(compiler_t *c);
+void yyerror(compiler_t *c, const char *fmt, ...);
+void lex_string(compiler_t *c, const char *buf, size_t len, int lineno);
+void lex_skip(compiler_t *c, char *p);
+token_t lex_sync(compiler_t *c, unsigned int tokens);
+
+#endif /* LEX_H */
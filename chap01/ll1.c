@@ -0,0 +1,82 @@
+/* Table-driven LL(1) parser. Recognizes the same language as plain.c, but
+ * keeps its own parse stack on the heap instead of recursing, so neither
+ * the number of statements nor the nesting depth uses up the C stack.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ll1.h"
+#include "parser.h"
+
+typedef struct {
+    unsigned char *syms;    /* parse stack, grows on demand */
+    int size;
+    int sp;                 /* number of symbols on it */
+} parse_stack_t;
+
+static void push(parse_stack_t *stack, int sym)
+{
+    if (stack->sp >= stack->size) {
+        stack->size = stack->size ? stack->size * 2 : 64;
+        if (!(stack->syms = realloc(stack->syms, stack->size))) {
+            fprintf(stderr, "Out of memory for parse stack\n");
+            exit(1);
+        }
+    }
+    stack->syms[stack->sp++] = sym;
+}
+
+static void synchronize(compiler_t *c, parse_stack_t *stack)
+{
+    /* Panic-mode recovery: throw away the rest of the statement, both on the
+     * stack and in the input, and start over with a fresh "statements".
+     */
+    while (!match(c, SEMI) && !match(c, EOI)) {
+        advance(c);
+    }
+    if (match(c, SEMI)) {
+        advance(c);
+    }
+    stack->sp = 0;
+    push(stack, STATEMENTS);
+}
+
+void ll1_statements(compiler_t *c)
+{
+    parse_stack_t stack = { NULL, 0, 0 };
+    int sym, prod, i;
+
+    push(&stack, STATEMENTS);
+
+    while (stack.sp > 0) {
+        sym = stack.syms[--stack.sp];
+        if (!ISNONTERM(sym)) {
+            if (match(c, sym)) {
+                advance(c);
+            } else if (sym == SEMI) {
+                yyerror(c, "Inserting missing semicolon");
+            } else if (sym == RP) {
+                yyerror(c, "Mismatched parenthesis");
+            } else {
+                yyerror(c, "Syntax error");
+                synchronize(c, &stack);
+            }
+            continue;
+        }
+
+        prod = LL_PROD(sym, lookahead(c));
+        if (prod == LL_ERROR) {
+            yyerror(c, "Syntax error");
+            synchronize(c, &stack);
+            continue;
+        }
+
+        /* Replace the nonterminal by its right-hand side, pushed backwards so
+         * that the leftmost symbol ends up on top.
+         */
+        for (i = Ll_rhs_start[prod + 1]; --i >= Ll_rhs_start[prod];) {
+            push(&stack, Ll_rhs[i]);
+        }
+    }
+    free(stack.syms);
+}
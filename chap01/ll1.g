@@ -0,0 +1,16 @@
+# The grammar in plain.c, rewritten so that it's LL(1), for ll1.c. llgen
+# makes lltab.c from it.
+
+%tokens EOI SEMI PLUS TIMES LP RP NUM ID
+
+statements  -> expression SEMI statements
+            |  epsilon
+expression  -> term expr_prime
+expr_prime  -> PLUS term expr_prime
+            |  epsilon
+term        -> factor term_prime
+term_prime  -> TIMES factor term_prime
+            |  epsilon
+factor      -> NUM
+            |  ID
+            |  LP expression RP
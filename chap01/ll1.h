@@ -0,0 +1,50 @@
+/* ll1.h
+ *
+ * Grammar symbols and parse tables for the table-driven LL(1) parser. The
+ * tables are made by llgen from the grammar in ll1.g.
+ */
+#ifndef LL1_H
+#define LL1_H
+
+#include "lex.h"
+
+/* Terminals are the token_t values. Nonterminals are numbered right after
+ * them so a single small integer names any grammar symbol, and the parse
+ * stack can be an array of bytes.
+ */
+#define NTERMS  UNKNOWN
+
+typedef enum {
+    STATEMENTS = NTERMS,
+    EXPRESSION,
+    EXPR_PRIME,
+    TERM,
+    TERM_PRIME,
+    FACTOR,
+    NSYMBOLS
+} nonterm_t;
+
+#define NNONTERMS       (NSYMBOLS - NTERMS)
+#define ISNONTERM(sym)  ((sym) >= NTERMS)
+#define LL_ERROR        0xff    /* Ll_rows entry for "no production" */
+
+/* in lltab.c */
+extern const int Ll_nprods;                 /* number of productions       */
+extern const unsigned char Ll_lhs[];        /* left-hand side of each one  */
+extern const unsigned char Ll_rhs_start[];  /* where each right-hand side
+                                               starts in Ll_rhs; one extra
+                                               entry marks the end         */
+extern const unsigned char Ll_rhs[];        /* right-hand sides, back to
+                                               back                        */
+extern const int Ll_ncols;                  /* columns in Ll_rows          */
+extern const unsigned char Ll_rows[];       /* the parse table, with rows
+                                               and columns that repeat
+                                               others left out             */
+extern const unsigned char Ll_rmap[NNONTERMS];  /* a nonterminal's row     */
+extern const unsigned char Ll_cmap[NTERMS];     /* a token's column        */
+
+/* The production to apply for a nonterminal and a lookahead. */
+#define LL_PROD(nt, tok) \
+    (Ll_rows[Ll_rmap[(nt) - NTERMS] * Ll_ncols + Ll_cmap[tok]])
+
+#endif /* LL1_H */
@@ -0,0 +1,571 @@
+/* llgen.c
+ *
+ * An LL(1) parser generator. It reads a grammar written the way the
+ * comments in plain.c write one, works out FIRST and FOLLOW, and from them
+ * the SELECT set of every production: the lookaheads that choose it. Then
+ * it writes the parse tables for ll1.c as C source (see ll1.h), along
+ * with FIRST and FOLLOW of each nonterminal for the error recovery in
+ * sets.c, or says where the grammar isn't LL(1).
+ *
+ *      llgen grammar > lltab.c
+ *
+ * The grammar is a list of productions:
+ *
+ *      %tokens EOI SEMI PLUS ...
+ *      statements  -> expression SEMI statements
+ *                  |  epsilon
+ *
+ * Every word is separated from the next by white space, and "#" starts a
+ * comment. The terminals are the ones listed after %tokens, in token_t
+ * order, since that's the order of the table's columns, and the first of
+ * them has to be the end of input; anything else is
+ * a nonterminal, numbered in the order their productions come, and the
+ * first is the start symbol. The C name of a symbol is its name in
+ * capitals, and the tables are checked against lex.h and ll1.h when
+ * they're compiled.
+ *
+ * The table is compressed as in the book: rows that are the same, and
+ * then columns that are the same, are kept only once, and two maps say
+ * which row a nonterminal uses and which column a token does.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MAXSYMS     128
+#define MAXTERMS    64          /* so a set of them fits in a uint64_t */
+#define MAXPRODS    254         /* 0xff is LL_ERROR */
+#define MAXRHS      255         /* Ll_rhs_start[] is unsigned char too */
+#define NONE        0xff
+
+typedef uint64_t set_t;
+
+typedef struct {
+    char *name;
+    bool terminal;
+    int number;             /* token_t, or NTERMS + which nonterminal */
+    int line;               /* where it was first used */
+} sym_t;
+
+static const char *Path;
+static int Lineno;
+static int Errors;
+
+static sym_t Syms[MAXSYMS];     /* in the order they're first seen */
+static int Nsyms;
+static int Nterms, Nnonterms;
+static int Order[MAXSYMS];      /* Order[number]: index into Syms */
+
+static int Lhs[MAXPRODS];       /* indexes into Syms */
+static int Rhs_start[MAXPRODS + 1];
+static int Rhs[MAXRHS];
+static int Nprods, Nrhs;
+
+static set_t First[MAXSYMS], Follow[MAXSYMS], Select[MAXPRODS];
+static bool Nullable[MAXSYMS];
+static unsigned char Table[MAXSYMS][MAXTERMS];
+
+static void error(const char *fmt, const char *arg)
+{
+    fprintf(stderr, "%s:%d: ", Path, Lineno);
+    fprintf(stderr, fmt, arg);
+    fputc('\n', stderr);
+    ++Errors;
+}
+
+static void fatal(const char *fmt, const char *arg)
+{
+    error(fmt, arg);
+    exit(1);
+}
+
+static int symbol(const char *name, bool terminal)
+{
+    /* The index in Syms of a name, entered the first time it's seen. */
+
+    int i;
+
+    for (i = 0; i < Nsyms; ++i) {
+        if (strcmp(Syms[i].name, name) == 0) {
+            if (terminal) {
+                error(Syms[i].terminal ? "Token %s listed twice"
+                      : "Token %s used before %%tokens lists it", name);
+            }
+            return i;
+        }
+    }
+    if (Nsyms == MAXSYMS) {
+        fatal("Too many symbols at %s", name);
+    }
+    if (terminal && Nterms == MAXTERMS) {
+        fatal("Too many tokens at %s", name);
+    }
+    if (!(Syms[i].name = strdup(name))) {
+        fatal("Out of memory at %s", name);
+    }
+    Syms[i].terminal = terminal;
+    Syms[i].number = terminal ? Nterms++ : -1;
+    Syms[i].line = Lineno;
+    return Nsyms++;
+}
+
+static void add_rhs(int sym)
+{
+    if (Nrhs == MAXRHS) {
+        fatal("Right-hand sides too long at %s", Syms[sym].name);
+    }
+    Rhs[Nrhs++] = sym;
+    Rhs_start[Nprods] = Nrhs;       /* the end of the newest production */
+}
+
+static void new_prod(int lhs)
+{
+    if (Nprods == MAXPRODS) {
+        fatal("Too many productions for %s", Syms[lhs].name);
+    }
+    Lhs[Nprods++] = lhs;
+    Rhs_start[Nprods] = Nrhs;
+}
+
+static void read_grammar(FILE *fp)
+{
+    char *line = NULL, *word, *next, *p;
+    size_t size = 0;
+    int lhs = -1, sym;
+    bool in_prod = false, empty;
+
+    while (getline(&line, &size, fp) >= 0) {
+        ++Lineno;
+        if ((p = strchr(line, '#'))) {
+            *p = '\0';
+        }
+        if (!(word = strtok(line, " \t\r\n"))) {
+            continue;
+        }
+
+        if (strcmp(word, "%tokens") == 0) {
+            while ((word = strtok(NULL, " \t\r\n"))) {
+                symbol(word, true);
+            }
+            in_prod = false;
+            continue;
+        }
+
+        if (strcmp(word, "|") != 0) {
+            /* A new left-hand side: "name -> ..." */
+            if (!(next = strtok(NULL, " \t\r\n")) || strcmp(next, "->") != 0) {
+                error("Expected -> after %s", word);
+                in_prod = false;
+                continue;
+            }
+            lhs = symbol(word, false);
+            if (Syms[lhs].terminal) {
+                error("Token %s on the left of a production", word);
+            }
+        } else if (!in_prod) {
+            error("%s with no production to add to", word);
+            continue;
+        }
+
+        /* The right-hand sides on the rest of the line. */
+        new_prod(lhs);
+        in_prod = true;
+        empty = true;
+        while ((word = strtok(NULL, " \t\r\n"))) {
+            if (strcmp(word, "|") == 0) {
+                if (empty) {
+                    error("Empty alternative: write %s", "epsilon");
+                }
+                new_prod(lhs);
+                empty = true;
+            } else if (strcmp(word, "epsilon") == 0) {
+                empty = false;
+            } else if (!isalpha((unsigned char)*word) && *word != '_') {
+                error("Bad symbol %s", word);
+            } else {
+                sym = symbol(word, false);
+                add_rhs(sym);
+                empty = false;
+            }
+        }
+        if (empty) {
+            error("Empty alternative: write %s", "epsilon");
+        }
+    }
+    free(line);
+}
+
+static void number_nonterminals(void)
+{
+    /* Nonterminals are numbered in the order they're defined. */
+
+    int prod, i;
+
+    for (i = 0; i < Nsyms; ++i) {
+        if (Syms[i].terminal) {
+            Order[Syms[i].number] = i;
+        }
+    }
+    for (prod = 0; prod < Nprods; ++prod) {
+        if (Syms[Lhs[prod]].number < 0) {
+            Syms[Lhs[prod]].number = Nterms + Nnonterms++;
+            Order[Syms[Lhs[prod]].number] = Lhs[prod];
+        }
+    }
+    for (i = 0; i < Nsyms; ++i) {
+        if (Syms[i].number < 0) {
+            Lineno = Syms[i].line;
+            error("%s is neither a token nor defined", Syms[i].name);
+        }
+    }
+    if (Nprods == 0) {
+        error("No productions in %s", Path);
+    }
+}
+
+static set_t first_of(int sym)
+{
+    return Syms[sym].terminal ? (set_t)1 << Syms[sym].number : First[sym];
+}
+
+static void compute_sets(void)
+{
+    /* Iterate over the productions until nothing changes: FIRST and
+     * nullability first, adding FIRST of each right-hand side up to and
+     * including the first symbol that can't vanish. Then FOLLOW: whatever
+     * can start the rest of a right-hand side can follow the nonterminal in
+     * front of it, and if the rest can vanish, so can whatever follows the
+     * left-hand side; the end of input follows the start symbol. SELECT of
+     * each production is then FIRST of its right-hand side, plus FOLLOW of
+     * its left-hand side if the right-hand side can vanish.
+     */
+    bool changed = true, nullable;
+    int prod, i, lhs, sym;
+    set_t rest, add;
+
+    while (changed) {
+        changed = false;
+        for (prod = 0; prod < Nprods; ++prod) {
+            lhs = Lhs[prod];
+            for (i = Rhs_start[prod]; i < Rhs_start[prod + 1]; ++i) {
+                sym = Rhs[i];
+                if ((First[lhs] | first_of(sym)) != First[lhs]) {
+                    First[lhs] |= first_of(sym);
+                    changed = true;
+                }
+                if (Syms[sym].terminal || !Nullable[sym]) {
+                    break;
+                }
+            }
+            if (i == Rhs_start[prod + 1] && !Nullable[lhs]) {
+                Nullable[lhs] = true;
+                changed = true;
+            }
+        }
+    }
+
+    Follow[Lhs[0]] = 1;                 /* EOI, token 0 */
+    changed = true;
+    while (changed) {
+        changed = false;
+        for (prod = 0; prod < Nprods; ++prod) {
+            lhs = Lhs[prod];
+            rest = 0;
+            nullable = true;
+            for (i = Rhs_start[prod + 1]; --i >= Rhs_start[prod];) {
+                sym = Rhs[i];
+                if (Syms[sym].terminal) {
+                    rest = first_of(sym);
+                    nullable = false;
+                    continue;
+                }
+                add = rest | (nullable ? Follow[lhs] : 0);
+                if ((Follow[sym] | add) != Follow[sym]) {
+                    Follow[sym] |= add;
+                    changed = true;
+                }
+                if (Nullable[sym]) {
+                    rest |= First[sym];
+                } else {
+                    rest = First[sym];
+                    nullable = false;
+                }
+            }
+        }
+    }
+
+    for (prod = 0; prod < Nprods; ++prod) {
+        nullable = true;
+        for (i = Rhs_start[prod]; i < Rhs_start[prod + 1] && nullable; ++i) {
+            Select[prod] |= first_of(Rhs[i]);
+            nullable = !Syms[Rhs[i]].terminal && Nullable[Rhs[i]];
+        }
+        if (nullable) {
+            Select[prod] |= Follow[Lhs[prod]];
+        }
+    }
+}
+
+static void build_table(void)
+{
+    /* Table[nonterminal][token] is the production whose SELECT set holds
+     * the token. Two of them for the same lookahead is a conflict.
+     */
+    int prod, t, row;
+
+    memset(Table, NONE, sizeof(Table));
+    for (prod = 0; prod < Nprods; ++prod) {
+        row = Syms[Lhs[prod]].number - Nterms;
+        for (t = 0; t < Nterms; ++t) {
+            if (!(Select[prod] >> t & 1)) {
+                continue;
+            }
+            if (Table[row][t] != NONE) {
+                fprintf(stderr, "%s: not LL(1): %s on %s could be production"
+                        " %d or %d\n", Path, Syms[Lhs[prod]].name,
+                        Syms[Order[t]].name, Table[row][t], prod);
+                ++Errors;
+            }
+            Table[row][t] = prod;
+        }
+    }
+}
+
+static void print_upper(FILE *fp, const char *name)
+{
+    while (*name) {
+        fputc(toupper((unsigned char)*name++), fp);
+    }
+}
+
+static void print_set(FILE *fp, set_t set)
+{
+    int t;
+
+    for (t = 0; t < Nterms; ++t) {
+        if (set >> t & 1) {
+            fprintf(fp, " %s", Syms[Order[t]].name);
+        }
+    }
+}
+
+static void print_bits(FILE *fp, set_t set)
+{
+    /* A set as a tokset_t (see sets.h) initializer. */
+
+    const char *sep = "";
+    int t;
+
+    for (t = 0; t < Nterms; ++t) {
+        if (set >> t & 1) {
+            fprintf(fp, "%sTOKBIT(", sep);
+            print_upper(fp, Syms[Order[t]].name);
+            fputc(')', fp);
+            sep = " | ";
+        }
+    }
+    if (!*sep) {
+        fputc('0', fp);
+    }
+}
+
+static void print_sets(FILE *fp, const char *name, set_t *sets)
+{
+    int i;
+
+    fprintf(fp, "\nconst tokset_t %s[NNONTERMS] = {\n", name);
+    for (i = 0; i < Nnonterms; ++i) {
+        fprintf(fp, "    [");
+        print_upper(fp, Syms[Order[Nterms + i]].name);
+        fprintf(fp, " - NTERMS] = ");
+        print_bits(fp, sets[Order[Nterms + i]]);
+        fprintf(fp, ",\n");
+    }
+    fprintf(fp, "};\n");
+}
+
+static int compress(int *map, int n, bool rows, int *keep)
+{
+    /* Fill map[] so that every row (or column) that's the same as an
+     * earlier one maps to it, and return how many are left. keep[k] is the
+     * original number of the k-th one kept.
+     */
+    int i, j, k, nkept = 0;
+
+    for (i = 0; i < n; ++i) {
+        for (k = 0; k < nkept; ++k) {
+            if (rows) {
+                if (memcmp(Table[i], Table[keep[k]], Nterms) == 0) {
+                    break;
+                }
+            } else {
+                for (j = 0; j < Nnonterms; ++j) {
+                    if (Table[j][i] != Table[j][keep[k]]) {
+                        break;
+                    }
+                }
+                if (j == Nnonterms) {
+                    break;
+                }
+            }
+        }
+        if (k == nkept) {
+            keep[nkept++] = i;
+        }
+        map[i] = k;
+    }
+    return nkept;
+}
+
+static void print_map(FILE *fp, const char *name, const char *size,
+                      const int *map, int n)
+{
+    int i;
+
+    fprintf(fp, "\nconst unsigned char %s[%s] = {\n   ", name, size);
+    for (i = 0; i < n; ++i) {
+        fprintf(fp, " %d,", map[i]);
+    }
+    fprintf(fp, "\n};\n");
+}
+
+static void print_tables(FILE *fp)
+{
+    int rmap[MAXSYMS], cmap[MAXTERMS], rkeep[MAXSYMS], ckeep[MAXTERMS];
+    int nrows, ncols, prod, i, r, k;
+
+    nrows = compress(rmap, Nnonterms, true, rkeep);
+    ncols = compress(cmap, Nterms, false, ckeep);
+
+    fprintf(fp, "/* lltab.c\n *\n"
+            " * Made by llgen from %s: change the grammar there, not the"
+            " tables here.\n *\n", Path);
+    for (prod = 0; prod < Nprods; ++prod) {
+        fprintf(fp, " * %2d: %-10s ->", prod, Syms[Lhs[prod]].name);
+        for (i = Rhs_start[prod]; i < Rhs_start[prod + 1]; ++i) {
+            fprintf(fp, " %s", Syms[Rhs[i]].name);
+        }
+        if (Rhs_start[prod] == Rhs_start[prod + 1]) {
+            fprintf(fp, " epsilon");
+        }
+        fprintf(fp, "\n *%*s{", 16, "");
+        print_set(fp, Select[prod]);
+        fprintf(fp, " }\n");
+    }
+    fprintf(fp, " *\n * The sets in braces are the lookaheads that select"
+            " each production.\n */\n\n#include \"sets.h\"\n\n");
+
+    /* The symbol numbers here have to be the ones the parser uses. */
+    fprintf(fp, "_Static_assert(NTERMS == %d && NNONTERMS == %d,\n"
+            "               \"%s doesn't match lex.h and ll1.h\");\n",
+            Nterms, Nnonterms, Path);
+    fprintf(fp, "_Static_assert(NTERMS <= sizeof(tokset_t) * 8,\n"
+            "               \"too many tokens for a tokset_t\");\n");
+    for (i = 0; i < Nterms + Nnonterms; ++i) {
+        fprintf(fp, "_Static_assert(");
+        print_upper(fp, Syms[Order[i]].name);
+        fprintf(fp, " == %d, \"%s\");\n", i, Syms[Order[i]].name);
+    }
+
+    fprintf(fp, "\nconst int Ll_nprods = %d;\nconst int Ll_ncols = %d;\n\n"
+            "const unsigned char Ll_lhs[] = {", Nprods, ncols);
+    for (prod = 0; prod < Nprods; ++prod) {
+        fprintf(fp, prod % 5 ? " " : "\n    ");
+        print_upper(fp, Syms[Lhs[prod]].name);
+        fputc(',', fp);
+    }
+
+    fprintf(fp, "\n};\n\nconst unsigned char Ll_rhs_start[] = {\n   ");
+    for (prod = 0; prod <= Nprods; ++prod) {
+        fprintf(fp, " %d,", Rhs_start[prod]);
+    }
+
+    fprintf(fp, "\n};\n\nconst unsigned char Ll_rhs[] = {\n");
+    for (prod = 0; prod < Nprods; ++prod) {
+        k = 0;
+        fprintf(fp, "   ");
+        for (i = Rhs_start[prod]; i < Rhs_start[prod + 1]; ++i) {
+            fputc(' ', fp);
+            print_upper(fp, Syms[Rhs[i]].name);
+            fputc(',', fp);
+            k += strlen(Syms[Rhs[i]].name) + 2;
+        }
+        fprintf(fp, "%*s/* %2d */\n", k < 32 ? 32 - k : 1, "", prod);
+    }
+    fprintf(fp, "};\n");
+
+    print_map(fp, "Ll_rmap", "NNONTERMS", rmap, Nnonterms);
+    print_map(fp, "Ll_cmap", "NTERMS", cmap, Nterms);
+
+    fprintf(fp, "\n/* Columns:");
+    for (k = 0; k < ncols; ++k) {
+        fprintf(fp, " %s", Syms[Order[ckeep[k]]].name);
+        for (i = ckeep[k] + 1; i < Nterms; ++i) {
+            if (cmap[i] == k) {
+                fprintf(fp, "/%s", Syms[Order[i]].name);
+            }
+        }
+    }
+    fprintf(fp, " */\n\n#define _  LL_ERROR\n\nconst unsigned char Ll_rows[] = {\n");
+    for (r = 0; r < nrows; ++r) {
+        fprintf(fp, "   ");
+        for (k = 0; k < ncols; ++k) {
+            if (Table[rkeep[r]][ckeep[k]] == NONE) {
+                fprintf(fp, "  _,");
+            } else {
+                fprintf(fp, " %2d,", Table[rkeep[r]][ckeep[k]]);
+            }
+        }
+        fprintf(fp, "   /* %s", Syms[Order[Nterms + rkeep[r]]].name);
+        for (i = rkeep[r] + 1; i < Nnonterms; ++i) {
+            if (rmap[i] == r) {
+                fprintf(fp, ", %s", Syms[Order[Nterms + i]].name);
+            }
+        }
+        fprintf(fp, " */\n");
+    }
+    fprintf(fp, "};\n");
+
+    print_sets(fp, "Ll_first", First);
+    print_sets(fp, "Ll_follow", Follow);
+
+    fprintf(stderr, "%d productions, %dx%d table kept as %dx%d\n",
+            Nprods, Nnonterms, Nterms, nrows, ncols);
+}
+
+int main(int argc, char *argv[])
+{
+    FILE *fp;
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s grammar > tables.c\n", argv[0]);
+        return 1;
+    }
+    Path = argv[1];
+    if (!(fp = fopen(Path, "r"))) {
+        perror(Path);
+        return 1;
+    }
+    read_grammar(fp);
+    fclose(fp);
+
+    number_nonterminals();
+    if (Errors) {
+        return 1;
+    }
+    if (Nterms == 0) {
+        fprintf(stderr, "%s: no %%tokens\n", Path);
+        return 1;
+    }
+    compute_sets();
+    build_table();
+    if (Errors) {
+        return 1;
+    }
+    print_tables(stdout);
+    return 0;
+}
@@ -1,8 +1,143 @@
 #include "lex.h"
+#include "ir.h"
+#include "vm.h"
+#include "batch.h"
+#include "memo.h"
+#include "parser.h"
+#include "timing.h"
+#include "diag.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <libgen.h>
 
-int main(int argc, const char *argv[])
+extern void parallel_statements(compiler_t *c, int nthreads);
+extern void incremental_statements(compiler_t *c);
+extern int compile_files(char **paths, int npaths, int nthreads);
+
+int main(int argc, char *argv[])
 {
-    statements();
-    return 0;
+    compiler_t c;
+    out_t out;
+    char *eq;
+    const parser_t *p;
+    int opt, jobs = 0, failed = 0;
+    bool incremental = false, pressure = false, rss = false;
+
+    /* The parser is named by -P, or else by the name the program was run
+     * under.
+     */
+    if ((p = find_parser(basename(argv[0])))) {
+        Parser = p;
+    }
+
+    while ((opt = getopt(argc, argv, "b:D:E:F:ij:MpP:O:rtT:")) != -1) {
+        switch (opt) {
+            case 'b':   /* back end: print the code, or run it */
+                if (strcmp(optarg, "text") == 0) {
+                    Backend = BACKEND_TEXT;
+                } else if (strcmp(optarg, "vm") == 0) {
+                    Backend = BACKEND_VM;
+                } else if (strcmp(optarg, "jit") == 0) {
+                    Backend = BACKEND_JIT;
+                } else if (strcmp(optarg, "flat") == 0) {
+                    Backend = BACKEND_FLAT;
+                } else {
+                    fprintf(stderr, "%s: unknown back end %s\n", argv[0], optarg);
+                    return 1;
+                }
+                break;
+            case 'D':   /* name=value: give a variable a value */
+                if (!(eq = strchr(optarg, '=')) || eq == optarg) {
+                    fprintf(stderr, "%s: -D wants name=value\n", argv[0]);
+                    return 1;
+                }
+                vm_bind(optarg, eq - optarg, strtoul(eq + 1, NULL, 0));
+                break;
+            case 'E':   /* give up after this many errors */
+                Max_errors = atoi(optarg);
+                break;
+            case 'F':   /* how to write diagnostics */
+                if (strcmp(optarg, "text") == 0) {
+                    Diag_format = DIAG_TEXT;
+                } else if (strcmp(optarg, "json") == 0) {
+                    Diag_format = DIAG_JSON;
+                } else {
+                    fprintf(stderr, "%s: unknown format %s\n", argv[0], optarg);
+                    return 1;
+                }
+                break;
+            case 'i':   /* recompile a series of snapshots incrementally */
+                incremental = true;
+                break;
+            case 'j':   /* compile statements on this many threads */
+                jobs = atoi(optarg);
+                break;
+            case 'M':   /* compile repeated statements again, every time */
+                Memoize = false;
+                break;
+            case 'p':   /* report how many temporaries statements needed */
+                pressure = true;
+                break;
+            case 'P':   /* parser */
+                if (!(Parser = find_parser(optarg))) {
+                    fprintf(stderr, "%s: unknown parser %s\n", argv[0], optarg);
+                    return 1;
+                }
+                break;
+            case 'O':   /* optimization level, 0 for none */
+                Optlevel = atoi(optarg);
+                break;
+            case 'r':   /* report peak memory use */
+                rss = true;
+                break;
+            case 't':   /* report the time spent in each phase */
+                Timing = true;
+                break;
+            case 'T':   /* run every statement over the rows of a table */
+                batch_load(optarg);
+                Backend = BACKEND_BATCH;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-iMprt] [-b text|vm|jit|flat] [-D name=value] [-E errors] [-F text|json] [-j threads] [-O level] [-P parser] [-T table] [file...]\n", argv[0]);
+                fprintf(stderr, "parsers:\n");
+                for (p = Parsers; p->name; ++p) {
+                    fprintf(stderr, "    %-9s %s\n", p->name, p->what);
+                }
+                return 1;
+        }
+    }
+
+    phase(PHASE_PARSE);
+    out_open(&out, 1);
+    compiler_init(&c, &out);
+    if (optind < argc) {
+        /* Compile the files named, each to its own .out file, with -j
+         * giving the number of threads.
+         */
+        failed = compile_files(argv + optind, argc - optind,
+                               jobs > 0 ? jobs : 1);
+    } else if (incremental) {
+        incremental_statements(&c);
+    } else if (jobs > 0) {
+        parallel_statements(&c, jobs);
+    } else {
+        statements(&c);
+    }
+    out_close(&out);
+    merge_pressure(&c);
+    compiler_free(&c);
+    diag_summary();
+
+    if (pressure) {
+        print_pressure(stderr);
+    }
+    if (Timing) {
+        merge_timing();
+        print_timing(stderr);
+    } else if (rss) {
+        print_rss(stderr);
+    }
+    return failed != 0;
 }
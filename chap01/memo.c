@@ -0,0 +1,205 @@
+/* memo.c
+ *
+ * The statement cache. Keys and outputs are kept back to back in one
+ * store, and entries refer to them by offset, so the store can grow
+ * without invalidating anything. Two entries can share an output: when a
+ * statement turns out to have the same tree as one already cached, its
+ * text is added as a second key for the same output. Once the store holds
+ * MEMO_MAX bytes nothing more is added, but lookups go on working.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "memo.h"
+
+bool Memoize = true;
+
+static void *grow(void *buf, uint32_t *max, size_t size, uint32_t need)
+{
+    if (need <= *max) {
+        return buf;
+    }
+    while (*max < need) {
+        *max = *max ? *max * 2 : 1024;
+    }
+    if (!(buf = realloc(buf, (size_t)*max * size))) {
+        fprintf(stderr, "Out of memory for statement cache\n");
+        exit(1);
+    }
+    return buf;
+}
+
+static uint32_t hash(const char *text, size_t len)
+{
+    uint32_t h = 2166136261u;   /* FNV-1a */
+
+    while (len--) {
+        h = (h ^ (unsigned char)*text++) * 16777619u;
+    }
+    return h;
+}
+
+static uint32_t save(memo_t *m, const char *p, size_t len)
+{
+    /* Copy "len" bytes to the store and return their offset. */
+
+    size_t need = m->nstore + len;
+    uint32_t off = m->nstore;
+
+    if (need > m->maxstore) {
+        while (m->maxstore < need) {
+            m->maxstore = m->maxstore ? m->maxstore * 2 : 64 * 1024;
+        }
+        if (!(m->store = realloc(m->store, m->maxstore))) {
+            fprintf(stderr, "Out of memory for statement cache\n");
+            exit(1);
+        }
+    }
+    memcpy(m->store + off, p, len);
+    m->nstore += len;
+    return off;
+}
+
+static void insert(memo_t *m, uint32_t e)
+{
+    uint32_t slot = m->entries[e].hash & (m->tablesize - 1);
+
+    while (m->table[slot]) {
+        slot = (slot + 1) & (m->tablesize - 1);
+    }
+    m->table[slot] = e;
+}
+
+static uint32_t new_entry(memo_t *m)
+{
+    /* Make an entry keyed by the pending text, if there is any. */
+
+    memo_entry_t *p;
+    uint32_t e;
+
+    m->entries = grow(m->entries, &m->maxentries, sizeof(memo_entry_t),
+                      m->nentries + 1);
+    e = m->nentries++;
+    p = &m->entries[e];
+    p->hash = m->pendinghash;
+    p->keylen = m->npending;
+    p->key = save(m, m->pending, m->npending);
+
+    if (m->npending) {
+        if (2 * m->nentries >= m->tablesize) {
+            free(m->table);
+            m->tablesize = m->tablesize ? m->tablesize * 2 : 1024;
+            if (!(m->table = calloc(m->tablesize, sizeof(uint32_t)))) {
+                fprintf(stderr, "Out of memory for statement cache\n");
+                exit(1);
+            }
+            for (e = 1; e < m->nentries - 1; ++e) {
+                if (m->entries[e].keylen) {
+                    insert(m, e);
+                }
+            }
+            e = m->nentries - 1;
+        }
+        insert(m, e);
+        m->npending = 0;
+    }
+    return e;
+}
+
+void memo_init(memo_t *m)
+{
+    memset(m, 0, sizeof(*m));
+    m->entries = grow(NULL, &m->maxentries, sizeof(memo_entry_t), 1);
+    m->nentries = 1;
+}
+
+void memo_free(memo_t *m)
+{
+    free(m->store);
+    free(m->entries);
+    free(m->table);
+    free(m->bynode);
+    free(m->pending);
+    memset(m, 0, sizeof(*m));
+}
+
+uint32_t memo_find(memo_t *m, const char *text, size_t len)
+{
+    /* Return the entry for a statement spelled "text", or 0 if there isn't
+     * one. On a miss the text is kept, to become the key of whatever entry
+     * the statement gets. An empty text means the statement has no usable
+     * spelling, and matches nothing.
+     */
+    uint32_t h, e, slot;
+
+    m->npending = 0;
+    if (len == 0) {
+        return 0;
+    }
+    h = hash(text, len);
+    if (m->tablesize) {
+        slot = h & (m->tablesize - 1);
+        while ((e = m->table[slot])) {
+            if (m->entries[e].hash == h && m->entries[e].keylen == len
+                    && memcmp(m->store + m->entries[e].key, text, len) == 0) {
+                return e;
+            }
+            slot = (slot + 1) & (m->tablesize - 1);
+        }
+    }
+
+    m->pending = grow(m->pending, &m->maxpending, 1, len);
+    memcpy(m->pending, text, len);
+    m->npending = len;
+    m->pendinghash = h;
+    return 0;
+}
+
+uint32_t memo_node(memo_t *m, node_t node)
+{
+    /* Return the entry for the statement whose tree is rooted at "node". */
+
+    return node < m->maxnodes ? m->bynode[node] : 0;
+}
+
+void memo_alias(memo_t *m, uint32_t e)
+{
+    /* Make the pending text another key for entry "e". */
+
+    uint32_t alias;
+
+    if (!m->npending || m->nstore + m->npending > MEMO_MAX) {
+        return;
+    }
+    alias = new_entry(m);
+    m->entries[alias].out = m->entries[e].out;
+    m->entries[alias].outlen = m->entries[e].outlen;
+}
+
+void memo_add(memo_t *m, node_t node, const char *out, size_t len)
+{
+    /* Cache the "len" bytes of output at "out" for the statement whose tree
+     * is rooted at "node", keyed by the pending text as well.
+     */
+    uint32_t e, old = m->maxnodes;
+
+    if (m->nstore + m->npending + len > MEMO_MAX) {
+        return;
+    }
+    e = new_entry(m);
+    m->entries[e].out = save(m, out, len);
+    m->entries[e].outlen = len;
+
+    m->bynode = grow(m->bynode, &m->maxnodes, sizeof(uint32_t), node + 1);
+    memset(m->bynode + old, 0, (m->maxnodes - old) * sizeof(uint32_t));
+    m->bynode[node] = e;
+}
+
+void memo_forget_nodes(memo_t *m)
+{
+    /* The syntax trees have been thrown away (see ast_reset()), so entries
+     * can only be found by their text from now on.
+     */
+    memset(m->bynode, 0, m->maxnodes * sizeof(uint32_t));
+}
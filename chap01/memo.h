@@ -0,0 +1,53 @@
+/* memo.h
+ *
+ * A cache of the output of statements already compiled, so that a
+ * statement seen before is printed without being parsed, compiled or run
+ * again. An entry is found either by the statement's text, before it's
+ * parsed, or by the root of its (hash-consed) syntax tree, which catches
+ * the same statement spelled differently.
+ */
+#ifndef MEMO_H
+#define MEMO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "ast.h"
+
+#define MEMO_MAX    (64 * 1024 * 1024)  /* most bytes of text and output */
+
+typedef struct {
+    uint32_t hash;          /* of the key */
+    uint32_t key, keylen;   /* statement text, as an offset into store */
+    uint32_t out, outlen;   /* what it printed, likewise */
+} memo_entry_t;
+
+typedef struct {
+    char *store;            /* keys and outputs, back to back */
+    size_t nstore, maxstore;
+    memo_entry_t *entries;  /* entries[0] is unused so 0 can mean "none" */
+    uint32_t nentries, maxentries;
+    uint32_t *table;        /* open-addressed, by text, 0 empty */
+    uint32_t tablesize;
+    uint32_t *bynode;       /* entry for each syntax tree node, or 0 */
+    uint32_t maxnodes;
+    char *pending;          /* text of the last lookup that missed */
+    uint32_t npending, maxpending, pendinghash;
+} memo_t;
+
+/* Off (-M) to compile every statement even if it's been seen before. */
+extern bool Memoize;
+
+/* in memo.c */
+void memo_init(memo_t *m);
+void memo_free(memo_t *m);
+uint32_t memo_find(memo_t *m, const char *text, size_t len);
+uint32_t memo_node(memo_t *m, node_t node);
+void memo_alias(memo_t *m, uint32_t e);
+void memo_add(memo_t *m, node_t node, const char *out, size_t len);
+void memo_forget_nodes(memo_t *m);
+
+#define MEMO_OUT(m, e)      ((m)->store + (m)->entries[e].out)
+#define MEMO_OUTLEN(m, e)   ((m)->entries[e].outlen)
+
+#endif /* MEMO_H */
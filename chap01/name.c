@@ -1,24 +1,116 @@
 #include "lex.h"
+#include "ir.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
 
-char *Names[] = {"t0", "t1", "t2", "t3", "t4", "t5", "t6", "t7"};
-char **Namep = Names;
+/* Temporaries are numbered, and kept on a stack in the compiler_t.
+ * temps[0..tempp-1] are in use, the rest are free, and newtemp() makes up
+ * a new one whenever every temporary made so far is in use.
+ *
+ * The peak number of temporaries in use at once is tracked for every
+ * statement: a statement is over when all of its temporaries have been
+ * freed again.
+ */
+static long *Total_pressure;            /* Pressure of every compilation, */
+static int Max_total_pressure;          /* merged by merge_pressure() */
+static pthread_mutex_t Lock = PTHREAD_MUTEX_INITIALIZER;
 
-char *newname(void)
+static void *xrealloc(void *p, size_t size)
 {
-    if (Namep >= &Names[sizeof(Names)/sizeof(*Names)]) {
-        fprintf(stderr, "%d: Expression too complex\n", yylineno);
+    if (!(p = realloc(p, size))) {
+        fprintf(stderr, "Out of memory for temporary names\n");
         exit(1);
     }
-    return (*Namep++);
+    return p;
 }
 
-void freename(char *s)
+static void count_pressure(compiler_t *c, int peak)
 {
-    if (Namep > Names) {
-        *--Namep = s;
+    /* c->pressure[n] = statements that needed n temporaries */
+
+    int old = c->maxpressure;
+
+    if (peak >= c->maxpressure) {
+        c->maxpressure = peak + 16;
+        c->pressure = xrealloc(c->pressure, c->maxpressure * sizeof(long));
+        memset(c->pressure + old, 0, (c->maxpressure - old) * sizeof(long));
+    }
+    ++c->pressure[peak];
+}
+
+int newtemp(compiler_t *c)
+{
+    if (c->tempp == c->ntemps) {
+        if (c->ntemps == c->maxtemps) {
+            c->maxtemps = c->maxtemps ? c->maxtemps * 2 : 8;
+            c->temps = xrealloc(c->temps, c->maxtemps * sizeof(int));
+        }
+        c->temps[c->ntemps] = c->ntemps;
+        ++c->ntemps;
+    }
+    if (c->tempp + 1 > c->peak) {
+        c->peak = c->tempp + 1;
+    }
+    return c->temps[c->tempp++];
+}
+
+void freetemp(compiler_t *c, int temp)
+{
+    if (c->tempp > 0) {
+        c->temps[--c->tempp] = temp;
+        if (c->tempp == 0) {
+            count_pressure(c, c->peak);
+            c->peak = 0;
+        }
     } else {
-        fprintf(stderr, "%d: (Internal error) Name stack underflow\n", yylineno);
+        yyerror(c, "(Internal error) Name stack underflow");
+    }
+}
+
+void merge_pressure(compiler_t *c)
+{
+    /* Add a compilation's statistics to the totals and clear them. */
+
+    int n, old;
+
+    pthread_mutex_lock(&Lock);
+    if (c->maxpressure > Max_total_pressure) {
+        old = Max_total_pressure;
+        Max_total_pressure = c->maxpressure;
+        Total_pressure = xrealloc(Total_pressure,
+                                  Max_total_pressure * sizeof(long));
+        memset(Total_pressure + old, 0,
+               (Max_total_pressure - old) * sizeof(long));
+    }
+    for (n = 0; n < c->maxpressure; ++n) {
+        Total_pressure[n] += c->pressure[n];
+        c->pressure[n] = 0;
+    }
+    pthread_mutex_unlock(&Lock);
+}
+
+void print_pressure(FILE *fp)
+{
+    /* Print how many statements needed how many temporaries at once. */
+
+    long statements = 0, sum = 0;
+    int n, max = 0;
+
+    for (n = 0; n < Max_total_pressure; ++n) {
+        if (Total_pressure[n]) {
+            statements += Total_pressure[n];
+            sum += n * Total_pressure[n];
+            max = n;
+        }
+    }
+
+    fprintf(fp, "Temporaries: %ld statements, peak %d, mean %.2f\n",
+            statements, max, statements ? (double)sum / statements : 0.0);
+    for (n = 1; n <= max; ++n) {
+        if (Total_pressure[n]) {
+            fprintf(fp, "%8d %10ld\n", n, Total_pressure[n]);
+        }
     }
 }
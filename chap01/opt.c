@@ -0,0 +1,304 @@
+/* opt.c
+ *
+ * Optimizing a statement's quads. Local value numbering gives every value
+ * the statement computes a number, the same number for the same constant,
+ * the same identifier, or the same operator applied to the same values, so
+ * a repeated subexpression is spotted with one hash lookup. An operator
+ * whose operands are both constants is folded into a new constant on the
+ * spot. The numbered values form a DAG, and the statement's code is then
+ * generated again from the DAG, starting at the value the statement leaves
+ * in its last quad's destination: every value is computed once, kept in a
+ * temporary until its last use, and anything the result doesn't depend on
+ * is dropped.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "lex.h"
+#include "ir.h"
+#include "timing.h"
+#include "scratch.h"
+
+int Optlevel = 2;       /* 0 to leave the code as generated */
+
+typedef enum { V_CONST, V_LEAF, V_OP } vkind_t;
+
+typedef struct {
+    vkind_t kind;
+    qop_t op;               /* V_OP: the operator,                     */
+    int a, b;               /*       and its operands' value numbers   */
+    unsigned long value;    /* V_CONST: the constant                   */
+    int opnd;               /* V_LEAF: the identifier (as an operand)  */
+    int uses;               /* uses by the code still to be generated  */
+    int temp;               /* temporary holding it, -1 if none yet    */
+} value_t;
+
+static _Thread_local value_t *Values;
+static _Thread_local int Nvalues, Maxvalues;
+static _Thread_local int *Table;        /* open-addressed, -1 empty */
+static _Thread_local int Tablesize;     /* part in use, a power of two */
+static _Thread_local int Maxtable;
+static _Thread_local int *Tempvn;       /* Tempvn[n]: value in temp n */
+static _Thread_local int Maxtempvn;
+static _Thread_local bool *Busy;        /* Busy[n]: temp n is in use */
+static _Thread_local int Maxbusy;
+
+static void *xrealloc(void *p, size_t size)
+{
+    if (!(p = realloc(p, size))) {
+        fprintf(stderr, "Out of memory for optimizer\n");
+        exit(1);
+    }
+    return p;
+}
+
+static void release(void)
+{
+    free(Values);
+    free(Table);
+    free(Tempvn);
+    free(Busy);
+    Values = NULL;
+    Table = Tempvn = NULL;
+    Busy = NULL;
+    Nvalues = Maxvalues = Tablesize = Maxtable = Maxtempvn = Maxbusy = 0;
+}
+
+static unsigned hash(value_t *v)
+{
+    unsigned a = v->a, b = v->b;
+
+    switch (v->kind) {
+        case V_CONST:
+            return (unsigned)(v->value ^ v->value >> 32) * 2654435761u;
+        case V_LEAF:
+            return (unsigned)v->opnd * 2246822519u + 1;
+        default:
+            if (a > b) {            /* both operators commute */
+                a = v->b;
+                b = v->a;
+            }
+            return ((a * 31 + b) * 4 + v->op) * 3266489917u + 2;
+    }
+}
+
+static bool same(value_t *v, value_t *w)
+{
+    if (v->kind != w->kind) {
+        return false;
+    }
+    switch (v->kind) {
+        case V_CONST:
+            return v->value == w->value;
+        case V_LEAF:
+            return v->opnd == w->opnd;
+        default:
+            return v->op == w->op && ((v->a == w->a && v->b == w->b)
+                                   || (v->a == w->b && v->b == w->a));
+    }
+}
+
+static int number(value_t *v)
+{
+    /* Return the number of the value described by v, giving it a new one
+     * if it hasn't been seen in this statement.
+     */
+    int slot = hash(v) & (Tablesize - 1), n;
+
+    while ((n = Table[slot]) >= 0) {
+        if (same(&Values[n], v)) {
+            return n;
+        }
+        slot = (slot + 1) & (Tablesize - 1);
+    }
+
+    v->uses = 0;
+    v->temp = -1;
+    Values[Nvalues] = *v;
+    return Table[slot] = Nvalues++;
+}
+
+static int operand(ir_t *ir, int opnd)
+{
+    value_t v = { 0 };
+
+    switch (OPND_KIND(opnd)) {
+        case OPND_TEMP:
+            if (Tempvn[OPND_INDEX(opnd)] >= 0) {
+                return Tempvn[OPND_INDEX(opnd)];
+            }
+            v.kind = V_LEAF;    /* used before it's set: only after errors */
+            v.opnd = opnd;
+            break;
+        case OPND_NUM:
+            v.kind = V_CONST;
+            v.value = IR_NUM(ir, opnd);
+            break;
+        default:
+            v.kind = V_LEAF;
+            v.opnd = opnd;
+            break;
+    }
+    return number(&v);
+}
+
+static int binary(qop_t op, int a, int b)
+{
+    value_t v = { 0 };
+
+    if (Values[a].kind == V_CONST && Values[b].kind == V_CONST) {
+        v.kind = V_CONST;
+        v.value = op == Q_ADD ? Values[a].value + Values[b].value
+                              : Values[a].value * Values[b].value;
+    } else {
+        v.kind = V_OP;
+        v.op = op;
+        v.a = a;
+        v.b = b;
+    }
+    return number(&v);
+}
+
+static void count(int n)
+{
+    /* Count the uses of every value that value n needs. */
+
+    if (Values[n].uses++ == 0 && Values[n].kind == V_OP) {
+        count(Values[n].a);
+        count(Values[n].b);
+    }
+}
+
+static int take_temp(void)
+{
+    /* The lowest numbered free temporary. */
+
+    int n, old = Maxbusy;
+
+    for (n = 0; n < Maxbusy && Busy[n]; ++n)
+        ;
+    if (n == Maxbusy) {
+        Maxbusy = Maxbusy ? Maxbusy * 2 : 16;
+        Busy = xrealloc(Busy, Maxbusy * sizeof(bool));
+        memset(Busy + old, 0, (Maxbusy - old) * sizeof(bool));
+    }
+    Busy[n] = true;
+    return n;
+}
+
+static int gen(ir_t *ir, int n)
+{
+    /* Return the temporary that holds value n, generating the code for it
+     * the first time. An operator's operands are only used up once the
+     * operator itself has been generated; then a temporary whose value
+     * has no uses left is freed, or taken over as the destination.
+     */
+    value_t *v = &Values[n];
+    int ta, tb;
+
+    if (v->temp < 0) {
+        switch (v->kind) {
+            case V_CONST:
+                v->temp = take_temp();
+                ir_gen(ir, Q_MOVE, TEMP(v->temp), ir_num(ir, v->value), 0);
+                break;
+            case V_LEAF:
+                v->temp = take_temp();
+                ir_gen(ir, Q_MOVE, TEMP(v->temp), v->opnd, 0);
+                break;
+            default:
+                ta = gen(ir, v->a);
+                tb = gen(ir, v->b);
+                --Values[v->a].uses;
+                --Values[v->b].uses;
+                if (Values[v->a].uses == 0) {
+                    v->temp = ta;
+                } else if (Values[v->b].uses == 0) {
+                    v->temp = tb;
+                } else {
+                    v->temp = take_temp();
+                }
+                if (Values[v->a].uses == 0 && ta != v->temp) {
+                    Busy[ta] = false;
+                }
+                if (Values[v->b].uses == 0 && tb != v->temp && tb != ta) {
+                    Busy[tb] = false;
+                }
+                ir_gen(ir, v->op, TEMP(v->temp), TEMP(ta), TEMP(tb));
+                break;
+        }
+    }
+    return v->temp;
+}
+
+static void value_number(ir_t *ir)
+{
+    ir_quad_t *q, *end = ir->quads + ir->nquads;
+    int maxtemp = 0, n, result;
+
+    if (ir->nquads == 0) {
+        return;
+    }
+
+    /* Each quad adds at most three values; keep the table half empty. */
+    if (Maxvalues < 3 * ir->nquads) {
+        scratch_atexit(release);
+        Maxvalues = 3 * ir->nquads;
+        Values = xrealloc(Values, Maxvalues * sizeof(value_t));
+    }
+    for (Tablesize = 64; Tablesize < 6 * ir->nquads; Tablesize *= 2)
+        ;
+    if (Tablesize > Maxtable) {
+        Maxtable = Tablesize;
+        Table = xrealloc(Table, Maxtable * sizeof(int));
+    }
+    memset(Table, -1, Tablesize * sizeof(int));
+    Nvalues = 0;
+
+    for (q = ir->quads; q < end; ++q) {
+        if (OPND_INDEX(q->dst) >= maxtemp) {
+            maxtemp = OPND_INDEX(q->dst) + 1;
+        }
+        if (OPND_KIND(q->src1) == OPND_TEMP && OPND_INDEX(q->src1) >= maxtemp) {
+            maxtemp = OPND_INDEX(q->src1) + 1;
+        }
+        if (q->op != Q_MOVE && OPND_KIND(q->src2) == OPND_TEMP
+                && OPND_INDEX(q->src2) >= maxtemp) {
+            maxtemp = OPND_INDEX(q->src2) + 1;
+        }
+    }
+    if (maxtemp > Maxtempvn) {
+        Maxtempvn = maxtemp;
+        Tempvn = xrealloc(Tempvn, Maxtempvn * sizeof(int));
+    }
+    memset(Tempvn, -1, maxtemp * sizeof(int));
+
+    for (q = ir->quads; q < end; ++q) {
+        n = operand(ir, q->src1);
+        if (q->op != Q_MOVE) {
+            n = binary(q->op, n, operand(ir, q->src2));
+        }
+        Tempvn[OPND_INDEX(q->dst)] = n;
+    }
+    result = Tempvn[OPND_INDEX(end[-1].dst)];
+
+    /* Generate the code again, from the DAG. */
+    count(result);
+    ir->nquads = 0;
+    ir->nconsts = 0;
+    gen(ir, result);
+    memset(Busy, 0, Maxbusy * sizeof(bool));
+}
+
+void optimize(ir_t *ir)
+{
+    phase_t was = phase(PHASE_OPTIMIZE);
+
+    if (Optlevel >= 1) {
+        value_number(ir);
+    }
+    if (Optlevel >= 2) {
+        peephole(ir);
+    }
+    phase(was);
+}
@@ -0,0 +1,123 @@
+/* out.c
+ *
+ * Output buffers; see out.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include "out.h"
+#include "timing.h"
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024    /* the least any Linux will take */
+#endif
+
+static void write_all(int fd, const char *buf, size_t len)
+{
+    ssize_t n;
+
+    while (len > 0) {
+        if ((n = write(fd, buf, len)) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("write");
+            exit(1);
+        }
+        buf += n;
+        len -= n;
+    }
+}
+
+void out_open(out_t *out, int fd)
+{
+    out->fd = fd;
+    out->len = 0;
+    out->size = OUT_FLUSH + 4096;
+
+    /* Someone at a terminal wants to see each statement's code as soon as
+     * it's generated.
+     */
+    out->limit = fd >= 0 && isatty(fd) ? 1 : OUT_FLUSH;
+    if (!(out->buf = malloc(out->size))) {
+        fprintf(stderr, "Out of memory for output buffer\n");
+        exit(1);
+    }
+}
+
+void out_close(out_t *out)
+{
+    out_flush(out);
+    free(out->buf);
+    out->buf = NULL;
+    out->len = out->size = 0;
+}
+
+void out_flush(out_t *out)
+{
+    phase_t was;
+
+    if (out->fd >= 0) {
+        was = phase(PHASE_OUTPUT);
+        write_all(out->fd, out->buf, out->len);
+        out->len = 0;
+        phase(was);
+    }
+}
+
+char *out_grow(out_t *out, size_t need)
+{
+    /* Make room for "need" more characters by making the buffer bigger.
+     * Nothing is written out here, even if the buffer has a file: callers
+     * keep offsets into what a statement has written so far (see
+     * retval.c), so only out_sync() and out_flush() may empty it.
+     */
+    if (out->len + need > out->size) {
+        while (out->len + need > out->size) {
+            out->size *= 2;
+        }
+        if (!(out->buf = realloc(out->buf, out->size))) {
+            fprintf(stderr, "Out of memory for output buffer\n");
+            exit(1);
+        }
+    }
+    return out->buf + out->len;
+}
+
+void out_writev(out_t *out, struct iovec *iov, int n)
+{
+    /* Write whatever is waiting in out, then the n pieces in iov, handing
+     * the kernel as many of them at a time as it will take.
+     */
+    ssize_t done;
+    int i;
+    phase_t was;
+
+    out_flush(out);
+    was = phase(PHASE_OUTPUT);
+    while (n > 0) {
+        if ((done = writev(out->fd, iov, n < IOV_MAX ? n : IOV_MAX)) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("writev");
+            exit(1);
+        }
+
+        /* Skip what was written; finish off a piece cut short by hand. */
+        for (i = 0; i < n && done >= iov[i].iov_len; ++i) {
+            done -= iov[i].iov_len;
+        }
+        if (i < n && done > 0) {
+            write_all(out->fd, (char *)iov[i].iov_base + done,
+                      iov[i].iov_len - done);
+            ++i;
+        }
+        iov += i;
+        n -= i;
+    }
+    phase(was);
+}
@@ -0,0 +1,69 @@
+/* out.h
+ *
+ * Output buffers for generated code. A buffer either collects everything
+ * in memory, or is drained to a file descriptor with large write()s
+ * between statements, once enough is waiting. A statement's output is
+ * never split: the buffer grows to hold all of it. Numbers and names are
+ * formatted by hand rather than through stdio.
+ */
+#ifndef OUT_H
+#define OUT_H
+
+#include <stddef.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#define OUT_FLUSH   (256 * 1024)    /* write out when this much is waiting */
+
+typedef struct {
+    char *buf;
+    size_t len, size;
+    size_t limit;           /* out_sync() writes out once this much waits */
+    int fd;                 /* where to write, or -1 to keep it all */
+} out_t;
+
+/* in out.c */
+void out_open(out_t *out, int fd);
+void out_close(out_t *out);
+void out_flush(out_t *out);
+char *out_grow(out_t *out, size_t need);
+void out_writev(out_t *out, struct iovec *iov, int n);
+
+static inline char *out_reserve(out_t *out, size_t need)
+{
+    /* Return a pointer to room for "need" more characters. */
+
+    if (out->len + need > out->size) {
+        return out_grow(out, need);
+    }
+    return out->buf + out->len;
+}
+
+static inline void out_mem(out_t *out, const char *s, size_t len)
+{
+    memcpy(out_reserve(out, len), s, len);
+    out->len += len;
+}
+
+static inline void out_ulong(out_t *out, unsigned long n)
+{
+    /* Write n in decimal: digits go into a scratch buffer backwards. */
+
+    char digits[20], *p = digits + sizeof(digits);
+
+    do {
+        *--p = '0' + n % 10;
+    } while (n /= 10);
+    out_mem(out, p, digits + sizeof(digits) - p);
+}
+
+static inline void out_sync(out_t *out)
+{
+    /* Called between statements: write out if enough is waiting. */
+
+    if (out->fd >= 0 && out->len >= out->limit) {
+        out_flush(out);
+    }
+}
+
+#endif /* OUT_H */
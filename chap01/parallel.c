@@ -0,0 +1,192 @@
+/* parallel.c
+ *
+ * Statement-parallel compilation. Statements only interact through the
+ * SEMI between them, so the input is read into memory, cut into chunks at
+ * semicolons, and each chunk is run through statements() on a pool of
+ * worker threads. Every chunk's generated code is captured in memory and
+ * written out in source order once all of them are done, so the output is
+ * the same as a serial run. Diagnostics go to stderr a whole line at a
+ * time (see diag.c), but lines from different chunks can come in any
+ * order.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <pthread.h>
+#include "lex.h"
+#include "ir.h"
+#include "parser.h"
+#include "timing.h"
+
+#define CHUNK_MIN   (64 * 1024)     /* smallest chunk worth a hand-off */
+#define CHUNKS_PER_THREAD 8         /* so that uneven chunks balance out */
+
+typedef struct {
+    const char *start;      /* source text of the chunk */
+    size_t len;
+    int lineno;             /* line number of its first character */
+    out_t out;              /* code generated for it */
+} chunk_t;
+
+typedef struct {
+    chunk_t *chunks;
+    int nchunks;
+    int next;               /* next chunk for a worker to take */
+    pthread_mutex_t lock;
+} pool_t;
+
+static char *read_input(size_t *lenp)
+{
+    /* Slurp all of standard input. */
+
+    size_t len = 0, size = 1 << 20, n;
+    char *buf = malloc(size);
+
+    while (buf && (n = fread(buf + len, 1, size - len, stdin)) > 0) {
+        if ((len += n) == size) {
+            buf = realloc(buf, size *= 2);
+        }
+    }
+    if (!buf) {
+        fprintf(stderr, "Out of memory for input\n");
+        exit(1);
+    }
+    *lenp = len;
+    return buf;
+}
+
+static bool blank(const char *p, const char *end)
+{
+    while (p < end && isspace((unsigned char)*p)) {
+        ++p;
+    }
+    return p == end;
+}
+
+static void split(pool_t *pool, const char *buf, size_t len, int nthreads)
+{
+    /* Cut the input into roughly equal chunks, each ending just past a
+     * semicolon (or at the end of the input), and note the line each one
+     * starts on. White space at the end of the input goes with the last
+     * chunk rather than making one of its own.
+     */
+    size_t target = len / ((size_t)nthreads * CHUNKS_PER_THREAD);
+    size_t pos = 0, end, max = 16;
+    const char *semi, *p;
+    int lineno = 1;
+
+    if (target < CHUNK_MIN) {
+        target = CHUNK_MIN;
+    }
+    pool->chunks = malloc(max * sizeof(chunk_t));
+
+    while (pool->chunks && pos < len) {
+        end = pos + target < len ? pos + target : len;
+        if (end < len && (semi = memchr(buf + end, ';', len - end))
+                && !blank(semi + 1, buf + len)) {
+            end = semi - buf + 1;
+        } else {
+            end = len;
+        }
+
+        if (pool->nchunks == max) {
+            pool->chunks = realloc(pool->chunks, (max *= 2) * sizeof(chunk_t));
+            if (!pool->chunks) {
+                break;
+            }
+        }
+        pool->chunks[pool->nchunks].start = buf + pos;
+        pool->chunks[pool->nchunks].len = end - pos;
+        pool->chunks[pool->nchunks].lineno = lineno;
+        ++pool->nchunks;
+
+        for (p = buf + pos; (p = memchr(p, '\n', buf + end - p)); ++p) {
+            ++lineno;
+        }
+        pos = end;
+    }
+    if (!pool->chunks) {
+        fprintf(stderr, "Out of memory for chunk list\n");
+        exit(1);
+    }
+}
+
+static void *worker(void *arg)
+{
+    pool_t *pool = arg;
+    compiler_t c;
+    chunk_t *chunk;
+    int i;
+
+    compiler_init(&c, NULL);
+    while (true) {
+        pthread_mutex_lock(&pool->lock);
+        i = pool->next++;
+        pthread_mutex_unlock(&pool->lock);
+        if (i >= pool->nchunks) {
+            break;
+        }
+
+        chunk = &pool->chunks[i];
+        out_open(&chunk->out, -1);
+        c.out = &chunk->out;
+        lex_string(&c, chunk->start, chunk->len, chunk->lineno);
+        statements(&c);
+    }
+
+    merge_pressure(&c);
+    merge_timing();
+    compiler_free(&c);
+    return NULL;
+}
+
+void parallel_statements(compiler_t *c, int nthreads)
+{
+    /* Compile standard input on nthreads threads, each chunk with its own
+     * compiler_t, and write the code to c->out.
+     */
+    out_t *out = c->out;
+    pool_t pool = { NULL, 0, 0 };
+    struct iovec *iov;
+    pthread_t *threads = malloc(nthreads * sizeof(pthread_t));
+    size_t len;
+    char *buf = read_input(&len);
+    int i;
+
+    split(&pool, buf, len, nthreads);
+    pthread_mutex_init(&pool.lock, NULL);
+
+    for (i = 0; i < nthreads; ++i) {
+        if (pthread_create(&threads[i], NULL, worker, &pool) != 0) {
+            fprintf(stderr, "Can't create worker thread\n");
+            exit(1);
+        }
+    }
+    for (i = 0; i < nthreads; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&pool.lock);
+
+    /* Hand all of the chunks' code to the kernel in as few calls as it will
+     * take.
+     */
+    if (!(iov = malloc((pool.nchunks + 1) * sizeof(struct iovec)))) {
+        fprintf(stderr, "Out of memory for chunk list\n");
+        exit(1);
+    }
+    for (i = 0; i < pool.nchunks; ++i) {
+        iov[i].iov_base = pool.chunks[i].out.buf;
+        iov[i].iov_len = pool.chunks[i].out.len;
+    }
+    out_writev(out, iov, pool.nchunks);
+    for (i = 0; i < pool.nchunks; ++i) {
+        free(pool.chunks[i].out.buf);
+    }
+    free(iov);
+
+    free(pool.chunks);
+    free(threads);
+    free(buf);
+}
@@ -0,0 +1,39 @@
+/* parser.c
+ *
+ * The table of parsers. The driver, parallel.c and incr.c all call
+ * statements(), which hands over to whichever one was picked.
+ */
+
+#include <string.h>
+#include "parser.h"
+
+const parser_t Parsers[] = {
+    { "lex",      lex_statements,      "no parsing, tokens only" },
+    { "plain",    plain_statements,    "recursive descent, no code" },
+    { "improved", improved_statements, "precedence climbing, no code" },
+    { "ll1",      ll1_statements,      "table-driven LL(1), no code" },
+    { "retval",   retval_statements,   "syntax tree, temporaries returned" },
+    { "args",     args_statements,     "temporaries passed down" },
+    { NULL },
+};
+
+const parser_t *Parser = &Parsers[4];
+
+const parser_t *find_parser(const char *name)
+{
+    /* Return the parser called "name", or NULL if there isn't one. */
+
+    const parser_t *p;
+
+    for (p = Parsers; p->name; ++p) {
+        if (strcmp(p->name, name) == 0) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+void statements(compiler_t *c)
+{
+    Parser->statements(c);
+}
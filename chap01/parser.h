@@ -0,0 +1,41 @@
+/* parser.h
+ *
+ * The parsers, all linked into one program and picked at run time (-P).
+ * Each one compiles statements from the lexer's input until it runs out.
+ */
+#ifndef PARSER_H
+#define PARSER_H
+
+#include "lex.h"
+
+typedef struct {
+    const char *name;
+    void (*statements)(compiler_t *c);
+    const char *what;       /* one line, for the usage message */
+} parser_t;
+
+/* in parser.c */
+extern const parser_t Parsers[];
+extern const parser_t *Parser;      /* the one statements() runs */
+const parser_t *find_parser(const char *name);
+void statements(compiler_t *c);
+
+/* in lex.c */
+void lex_statements(compiler_t *c);
+
+/* in plain.c */
+void plain_statements(compiler_t *c);
+
+/* in improved.c */
+void improved_statements(compiler_t *c);
+
+/* in ll1.c */
+void ll1_statements(compiler_t *c);
+
+/* in retval.c */
+void retval_statements(compiler_t *c);
+
+/* in args.c */
+void args_statements(compiler_t *c);
+
+#endif /* PARSER_H */
@@ -0,0 +1,231 @@
+/* peep.c
+ *
+ * A peephole pass over a statement's quads, run after value numbering
+ * (see opt.c). A liveness pass from the end of the statement first marks
+ * where each temporary is read for the last time. Then, looking a few
+ * quads ahead of every move:
+ *
+ *      t1 = X ... u = t1 op y   becomes   u = X op y
+ *
+ * when that is t1's only use and X doesn't change in between, which does
+ * away with loads into temporaries and with chains of copies. Identities
+ * are simplified as they turn up:
+ *
+ *      x + 0 => x      x * 1 => x      x * 0 => 0      x * 2 => x + x
+ *
+ * and a last liveness pass drops whatever no longer contributes to the
+ * result, the value left in the destination of the statement's last quad.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "lex.h"
+#include "ir.h"
+#include "scratch.h"
+
+#define WINDOW  16      /* how far ahead to look for a move's only use */
+
+#define DIES1   1       /* src1 is the last use of its temporary */
+#define DIES2   2       /* ... and src2 */
+#define GONE    4       /* the quad has been deleted */
+
+static _Thread_local unsigned char *Flags;  /* Flags[i] for quad i */
+static _Thread_local int Maxflags;
+static _Thread_local bool *Live;
+static _Thread_local int Maxlive;
+
+static void *xrealloc(void *p, size_t size)
+{
+    if (!(p = realloc(p, size))) {
+        fprintf(stderr, "Out of memory for optimizer\n");
+        exit(1);
+    }
+    return p;
+}
+
+static void release(void)
+{
+    free(Flags);
+    free(Live);
+    Flags = NULL;
+    Live = NULL;
+    Maxflags = Maxlive = 0;
+}
+
+static bool is_temp(int opnd)
+{
+    return OPND_KIND(opnd) == OPND_TEMP;
+}
+
+static void liveness(ir_t *ir)
+{
+    /* Working back from the end, delete every quad whose destination isn't
+     * needed later and mark the last use of each temporary. Only the
+     * result is live at the end.
+     */
+    ir_quad_t *q;
+    int i, n = 0;
+
+    for (q = ir->quads; q < ir->quads + ir->nquads; ++q) {
+        if (OPND_INDEX(q->dst) >= n) {
+            n = OPND_INDEX(q->dst) + 1;
+        }
+        if (is_temp(q->src1) && OPND_INDEX(q->src1) >= n) {
+            n = OPND_INDEX(q->src1) + 1;
+        }
+        if (q->op != Q_MOVE && is_temp(q->src2) && OPND_INDEX(q->src2) >= n) {
+            n = OPND_INDEX(q->src2) + 1;
+        }
+    }
+    if (n > Maxlive) {
+        Maxlive = n;
+        Live = xrealloc(Live, Maxlive * sizeof(bool));
+    }
+    memset(Live, 0, n * sizeof(bool));
+    Live[OPND_INDEX(ir->quads[ir->nquads - 1].dst)] = true;
+
+    for (i = ir->nquads; --i >= 0;) {
+        q = &ir->quads[i];
+        if (Flags[i] & GONE) {
+            continue;
+        }
+        if (!Live[OPND_INDEX(q->dst)]) {
+            Flags[i] = GONE;
+            continue;
+        }
+
+        Flags[i] = 0;
+        Live[OPND_INDEX(q->dst)] = false;
+        if (is_temp(q->src1) && !Live[OPND_INDEX(q->src1)]) {
+            Flags[i] |= DIES1;
+            Live[OPND_INDEX(q->src1)] = true;
+        }
+        if (q->op != Q_MOVE && is_temp(q->src2) && !Live[OPND_INDEX(q->src2)]) {
+            Flags[i] |= DIES2;
+            Live[OPND_INDEX(q->src2)] = true;
+        }
+    }
+}
+
+static void simplify(ir_t *ir, ir_quad_t *q, unsigned char *flags)
+{
+    /* Apply the identities to a quad with a constant operand, which is
+     * moved to src2 first.
+     */
+    unsigned long a, b;
+    int t;
+
+    if (q->op == Q_MOVE) {
+        return;
+    }
+    if (OPND_KIND(q->src1) == OPND_NUM) {
+        t = q->src1;
+        q->src1 = q->src2;
+        q->src2 = t;
+        *flags = (*flags & GONE) | (*flags & DIES1) << 1 | (*flags & DIES2) >> 1;
+    }
+    if (OPND_KIND(q->src2) != OPND_NUM) {
+        return;
+    }
+
+    b = IR_NUM(ir, q->src2);
+    if (OPND_KIND(q->src1) == OPND_NUM) {
+        a = IR_NUM(ir, q->src1);
+        q->src1 = ir_num(ir, q->op == Q_ADD ? a + b : a * b);
+        q->op = Q_MOVE;
+        *flags &= ~(DIES1 | DIES2);
+    } else if ((q->op == Q_ADD && b == 0) || (q->op == Q_MUL && b == 1)) {
+        q->op = Q_MOVE;
+        *flags &= ~DIES2;
+    } else if (q->op == Q_MUL && b == 0) {
+        q->op = Q_MOVE;
+        q->src1 = q->src2;
+        *flags &= ~(DIES1 | DIES2);
+    } else if (q->op == Q_MUL && b == 2) {
+        q->op = Q_ADD;
+        q->src2 = q->src1;
+        *flags &= ~DIES2;
+    }
+}
+
+static void forward(ir_t *ir, int i)
+{
+    /* Quad i is a move into a temporary: if one of the next few quads is
+     * the temporary's last use, and the moved operand is still the same
+     * there, have that quad use the operand instead and delete the move.
+     */
+    ir_quad_t *q = &ir->quads[i], *r;
+    int t = q->dst, x = q->src1, j, end;
+    bool reads1, reads2;
+
+    if (x == t) {
+        Flags[i] = GONE;
+        return;
+    }
+
+    end = i + WINDOW < ir->nquads ? i + WINDOW : ir->nquads;
+    for (j = i + 1; j < end; ++j) {
+        r = &ir->quads[j];
+        if (Flags[j] & GONE) {
+            continue;
+        }
+        reads1 = r->src1 == t;
+        reads2 = r->op != Q_MOVE && r->src2 == t;
+        if (reads1 || reads2) {
+            if (!((reads1 && (Flags[j] & DIES1))
+                    || (reads2 && (Flags[j] & DIES2)))) {
+                return;         /* t is used again later */
+            }
+            Flags[j] &= ~((reads1 ? DIES1 : 0) | (reads2 ? DIES2 : 0));
+            if (reads1) {
+                r->src1 = x;
+            }
+            if (reads2) {
+                r->src2 = x;
+            }
+            if (Flags[i] & DIES1) {     /* x's last use moves along */
+                Flags[j] |= reads1 ? DIES1 : DIES2;
+            }
+            Flags[i] = GONE;
+            simplify(ir, r, &Flags[j]);
+            return;
+        }
+        if (r->dst == t || r->dst == x) {
+            return;             /* t is dead, or x changes, before a use */
+        }
+    }
+}
+
+void peephole(ir_t *ir)
+{
+    ir_quad_t *q, *to;
+    int i;
+
+    if (ir->nquads == 0) {
+        return;
+    }
+    if (ir->nquads > Maxflags) {
+        scratch_atexit(release);
+        Maxflags = ir->nquads * 2;
+        Flags = xrealloc(Flags, Maxflags);
+    }
+    memset(Flags, 0, ir->nquads);
+
+    liveness(ir);
+    for (i = 0; i < ir->nquads; ++i) {
+        if (!(Flags[i] & GONE)) {
+            simplify(ir, &ir->quads[i], &Flags[i]);
+            if (ir->quads[i].op == Q_MOVE) {
+                forward(ir, i);
+            }
+        }
+    }
+    liveness(ir);
+
+    for (q = to = ir->quads, i = 0; i < ir->nquads; ++i, ++q) {
+        if (!(Flags[i] & GONE)) {
+            *to++ = *q;
+        }
+    }
+    ir->nquads = to - ir->quads;
+}
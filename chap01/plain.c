@@ -2,87 +2,95 @@
 
 #include <stdio.h>
 #include "lex.h"
+#include "parser.h"
 
-void statements(void);
-void expression(void);
-void expr_prime(void);
-void term(void);
-void term_prime(void);
-void factor(void);
+static void expression(compiler_t *c);
+static void expr_prime(compiler_t *c);
+static void term(compiler_t *c);
+static void term_prime(compiler_t *c);
+static void factor(compiler_t *c);
 
-void statements(void)
+void plain_statements(compiler_t *c)
 {
     /* statements -> expression SEMI
      *            |  expression SEMI statements
      */
-    expression();
+    char *start;
+    int line;
 
-    if (match(SEMI)) {
-        advance();
-    } else {
-        fprintf(stderr, "%d: Inserting missing semicolon\n", yylineno);
-    }
+    do {
+        lookahead(c);
+        start = c->text;
+        line = c->lineno;
+        expression(c);
 
-    if (! match(EOI)) {
-        statements();
-    }
+        if (match(c, SEMI)) {
+            advance(c);
+        } else {
+            yyerror(c, "Inserting missing semicolon");
+            if (c->text == start && c->lineno == line) {
+                advance(c);     /* nothing could be made of it: drop it */
+            }
+        }
+    } while (! match(c, EOI));
 }
 
-void expression(void)
+static void expression(compiler_t *c)
 {
     /* expression -> term expression' */
-    term();
-    expr_prime();
+    term(c);
+    expr_prime(c);
 }
 
-void expr_prime(void)
+static void expr_prime(compiler_t *c)
 {
     /* expression' -> PLUS term expression'
      *             |  epsilon
      */
 
-    if (match(PLUS)) {
-        advance();
-        term();
-        expr_prime();
+    if (match(c, PLUS)) {
+        advance(c);
+        term(c);
+        expr_prime(c);
     }
 }
 
-void term(void)
+static void term(compiler_t *c)
 {
     /* term -> factor term' */
-    factor();
-    term_prime();
+    factor(c);
+    term_prime(c);
 }
 
-void term_prime(void)
+static void term_prime(compiler_t *c)
 {
     /* term' -> TIMES factor term'
      *       |  epsilon
      */
-    if (match(TIMES)) {
-        advance();
-        factor();
-        term_prime();
+    if (match(c, TIMES)) {
+        advance(c);
+        factor(c);
+        term_prime(c);
     }
 }
 
-void factor(void)
+static void factor(compiler_t *c)
 {
-    /* factor -> NUM_OR_ID
+    /* factor -> NUM
+     *        |  ID
      *        |  LP expression RP
      */
-    if (match(NUM_OR_ID)) {
-        advance();
-    } else if (match(LP)) {
-        advance();
-        expression();
-        if (match (RP)) {
-            advance();
+    if (match(c, NUM) || match(c, ID)) {
+        advance(c);
+    } else if (match(c, LP)) {
+        advance(c);
+        expression(c);
+        if (match(c, RP)) {
+            advance(c);
         } else {
-            fprintf(stderr, "%d: Mismatched parenthesis\n", yylineno);
+            yyerror(c, "Mismatched parenthesis");
         }
     } else {
-        fprintf(stderr, "%d Number or identifier expected\n", yylineno);
+        yyerror(c, "Number or identifier expected");
     }
 }
@@ -1,150 +1,177 @@
-/* Revised parser */
+/* Revised parser. Each statement is parsed into a syntax tree (see tree.c),
+ * then code is generated from the tree, with every subtree returning the
+ * temporary that holds its value. Subtrees are evaluated in Sethi-Ullman
+ * order, the one needing more temporaries first. The code goes into a quad
+ * array (see ir.c) that's printed once the statement is complete.
+ *
+ * What a statement printed is remembered (see memo.c), and a statement
+ * that's been seen before just prints it again. One that sits on a single
+ * line is looked up by its text before it's parsed; otherwise it's looked
+ * up by its tree, which the arena shares between identical expressions.
+ * So the trees are kept from one statement to the next, but only while
+ * they're any use: without the memo, or once the arena holds AST_MAX
+ * bytes, they're thrown away, and the memo forgets the nodes it knew.
+ *
+ * The arena, the quads and the memo are kept in the compiler_t between
+ * calls, so a caller that hands over one statement at a time (incr.c)
+ * doesn't set them up again for each one.
+ */
 
 #include <stdio.h>
-#include <stdarg.h>
+#include <stdlib.h>
 #include <stdbool.h>
-#include "lex.h"
-
-char *factor(void);
-char *term(void);
-char *expression(void);
-bool legal_lookahead(token_t first_arg,...);
-extern char *newname(void);
-extern void freename(char *name);
-
-void statements(void)
+#include <string.h>
+#include "ast.h"
+#include "ir.h"
+#include "memo.h"
+#include "parser.h"
+
+static int gen(compiler_t *c, arena_t *arena, ir_t *ir, node_t node);
+
+/* The quad that applies each binary operator, indexed by token, and whether
+ * its operands can be evaluated in either order.
+ */
+static const struct {
+    qop_t op;
+    bool commutative;
+} Binop[UNKNOWN] = {
+    [PLUS]  = { Q_ADD, true },
+    [TIMES] = { Q_MUL, true },
+};
+
+typedef struct {
+    arena_t arena;
+    ir_t ir;
+    memo_t memo;
+} state_t;
+
+static void free_state(void *arg)
 {
-    /* statements -> expression SEMI | expression SEMI statements */
-    char *tempvar;
-    while (! match(EOI)) {
-        tempvar = expression();
-
-        if (match(SEMI)) {
-            advance();
-        } else {
-            fprintf(stderr, "%d: Inserting missing semicolon\n", yylineno);
-        }
+    state_t *s = arg;
 
-        freename(tempvar);
-    }
+    memo_free(&s->memo);
+    ir_free(&s->ir);
+    ast_free(&s->arena);
+    free(s);
 }
 
-char *expression(void)
+void retval_statements(compiler_t *c)
 {
-    /* expression -> term expression'
-     * expression' -> PLUS term expression' | epsilon */
-    char *tempvar, *tempvar2;
-
-    tempvar = term();
-    while (match(PLUS)) {
-        advance();
-        tempvar2 = term();
-        printf("    %s += %s\n", tempvar, tempvar2);
-        freename(tempvar2);
+    /* statements -> expression SEMI | expression SEMI statements */
+    state_t *s = c->parser;
+    node_t root;
+    char *start, *semi;
+    size_t mark;
+    uint32_t e;
+    int temp, errors;
+    bool cache = Memoize && Backend != BACKEND_BATCH, clean;
+
+    if (!s) {
+        if (!(s = malloc(sizeof(*s)))) {
+            fprintf(stderr, "Out of memory for parser\n");
+            exit(1);
+        }
+        ast_init(&s->arena);
+        ir_init(&s->ir);
+        memo_init(&s->memo);
+        c->parser = s;
+        c->parser_free = free_state;
     }
 
-    return tempvar;
-}
+    while (! match(c, EOI)) {
+        start = c->text;
+        semi = cache ? strchr(start, ';') : NULL;
+        if (semi && (e = memo_find(&s->memo, start, semi + 1 - start))) {
+            out_mem(c->out, MEMO_OUT(&s->memo, e), MEMO_OUTLEN(&s->memo, e));
+            out_sync(c->out);
+            lex_skip(c, semi + 1);
+            continue;
+        } else if (!semi) {
+            memo_find(&s->memo, NULL, 0);
+        }
 
-char *term(void)
-{
-    /* term -> factor term' 
-     * term' -> TIMES factor term'
-     *       |  epsilon
-     */
-    char *tempvar, *tempvar2;
-
-    tempvar = factor();
-    while (match(TIMES)) {
-        advance();
-        tempvar2 = factor();
-        printf("    %s *= %s\n", tempvar, tempvar2);
-        freename(tempvar2);
-    }
+        errors = c->nerrs;
+        root = tree_expression(c, &s->arena);
 
-    return tempvar;
-}
+        if (match(c, SEMI)) {
+            advance(c);
+        } else {
+            yyerror(c, "Inserting missing semicolon");
+        }
 
-char *factor(void)
-{
-    /* factor -> NUM_OR_ID
-     *        |  LP expression RP
-     */
-    char *tempvar;
-
-    if (match(NUM_OR_ID)) {
-        /* print the assignment instruction. The %0.*s conversion is a form of
-         * %X.Ys, where X is the field width and Y is the maximum number of
-         * characters that will be printed (even if the string is longer). I'm
-         * using the %0.*s to print the string because it's not \0 terminated.
-         * The field has a default width of 0, but it will grow the size
-         * needed to print the string. The ".*" tells printf() to take the
-         * maximum-number-of-characters count from the next argument(yyleng) */
-        printf("    %s = %.*s\n", tempvar = newname(), yyleng, yytext);
-        advance();
-    } else if (match(LP)) {
-        advance();
-        tempvar = expression();
-        if (match(RP)) {
-            advance();
+        /* Only statements without errors are cached, since looking one up
+         * skips its error messages too.
+         */
+        clean = c->nerrs == errors;
+        if (cache && clean && (e = memo_node(&s->memo, root))) {
+            out_mem(c->out, MEMO_OUT(&s->memo, e), MEMO_OUTLEN(&s->memo, e));
+            memo_alias(&s->memo, e);
         } else {
-            fprintf(stderr, "%d: Mismatched parenthesis\n", yylineno);
+            mark = c->out->len;
+            ir_clear(&s->ir);
+            if ((temp = gen(c, &s->arena, &s->ir, root)) >= 0) {
+                freetemp(c, temp);
+            }
+            optimize(&s->ir);
+            generate(c, &s->ir, clean);
+            if (cache && clean) {
+                memo_add(&s->memo, root, c->out->buf + mark,
+                         c->out->len - mark);
+            }
         }
-    } else {
-        fprintf(stderr, "%d: Number of identifier expected\n", yylineno);
-    }
+        out_sync(c->out);
 
-    return tempvar;
+        if (!cache) {
+            ast_reset(&s->arena);
+        } else if (AST_SIZE(&s->arena) > AST_MAX) {
+            ast_reset(&s->arena);
+            memo_forget_nodes(&s->memo);
+        }
+    }
 }
 
-#define MAXFIRST 16
-#define SYNCH   SEMI
-bool legal_lookahead(token_t first_arg,...)
+static int gen(compiler_t *c, arena_t *arena, ir_t *ir, node_t node)
 {
-    /* simple error detection and recovery. Arguments are a 0-terminated list
-     * of those token that can legitimately come next in the input. If the
-     * list is empty, the end of file must come next. Print an error message
-     * if necessary. Error recovery is performed by discarding all input
-     * symboals until one that's in the input list is found
-     *
-     * Return treu if there's no error or if we recovered from the error,
-     * false if we can't recover.
+    /* Generate code for the tree rooted at "node" and return the temporary
+     * that holds its value (-1 for an empty tree, which is what's left of
+     * an expression with a syntax error). Of the two operands of a
+     * commutative operator, the one needing more temporaries goes first:
+     * its temporaries are all free again by the time the other one starts,
+     * so the pair needs no more than the bigger one does alone (or one more
+     * if they're equal).
      */
-    va_list args;
-    token_t tok;
-    token_t lookaheads[MAXFIRST], *p = lookaheads, *current;
-    int error_printed = 0;
-    int ret_val = 0;
-
-    va_start(args, first_arg);
+    ast_node *p = AST(arena, node);
+    int temp, temp2;
+    node_t first, second;
 
-    if (! first_arg) {
-        if (match(EOF)) {
-            ret_val = true;
-        }
-    } else {
-        *p++ = first_arg;
-        while ((tok = va_arg(args, token_t)) && p < &lookaheads[MAXFIRST]) {
-            *++p = tok;
-        }
-        while (!match(SYNCH)) {
-            for(current = lookaheads; current < p; ++current) {
-                if (match(*current)) {
-                    ret_val = true;
-                    goto exit;
-                }
-            }
+    if (!node) {
+        return -1;
+    }
 
-            if (! error_printed) {
-                fprintf(stderr, "Line %d: Syntax error\n", yylineno);
-                error_printed = 1;
+    switch (p->op) {
+        case NUM:
+            ir_gen(ir, Q_MOVE, TEMP(temp = newtemp(c)),
+                   ir_num(ir, p->u.value), 0);
+            break;
+        case ID:
+            ir_gen(ir, Q_MOVE, TEMP(temp = newtemp(c)),
+                   ir_id(ir, AST_NAME(arena, p), p->u.id.len), 0);
+            break;
+        default:
+            first = p->u.kids.left;
+            second = p->u.kids.right;
+            if (Binop[p->op].commutative
+                    && AST(arena, second)->need > AST(arena, first)->need) {
+                first = p->u.kids.right;
+                second = p->u.kids.left;
             }
 
-            advance();
-        }
+            temp = gen(c, arena, ir, first);
+            temp2 = gen(c, arena, ir, second);
+            ir_gen(ir, Binop[p->op].op, TEMP(temp), TEMP(temp), TEMP(temp2));
+            freetemp(c, temp2);
+            break;
     }
 
-exit:
-    va_end(args);
-    return ret_val;
+    return temp;
 }
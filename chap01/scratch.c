@@ -0,0 +1,55 @@
+/* scratch.c
+ *
+ * Each thread's release functions hang off one pthread key, whose
+ * destructor runs them when the thread exits. The main thread's scratch
+ * goes with the process.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "scratch.h"
+
+#define MAXRELEASE  8       /* more than there are modules with scratch */
+
+static pthread_key_t Key;
+static pthread_once_t Once = PTHREAD_ONCE_INIT;
+
+static _Thread_local void (*Release[MAXRELEASE])(void);
+static _Thread_local int Nrelease;
+
+static void release_all(void *unused)
+{
+    while (Nrelease > 0) {
+        Release[--Nrelease]();
+    }
+}
+
+static void make_key(void)
+{
+    if (pthread_key_create(&Key, release_all) != 0) {
+        fprintf(stderr, "Can't create thread key\n");
+        exit(1);
+    }
+}
+
+void scratch_atexit(void (*release)(void))
+{
+    /* Have release() called when this thread exits, once however many
+     * times it's asked for.
+     */
+    int i;
+
+    for (i = 0; i < Nrelease; ++i) {
+        if (Release[i] == release) {
+            return;
+        }
+    }
+    if (Nrelease == MAXRELEASE) {
+        fprintf(stderr, "Too many thread release functions\n");
+        exit(1);
+    }
+    pthread_once(&Once, make_key);
+    Release[Nrelease++] = release;
+    pthread_setspecific(Key, Release);
+}
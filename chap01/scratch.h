@@ -0,0 +1,14 @@
+/* scratch.h
+ *
+ * Thread-local scratch. The optimizer and back ends keep their work
+ * arrays per thread and grow them as they go; a module that does so
+ * calls scratch_atexit() when it first allocates on a thread, and its
+ * release function frees them when that thread exits.
+ */
+#ifndef SCRATCH_H
+#define SCRATCH_H
+
+/* in scratch.c */
+void scratch_atexit(void (*release)(void));
+
+#endif /* SCRATCH_H */
@@ -0,0 +1,52 @@
+/* sets.c
+ *
+ * FIRST and FOLLOW sets, kept as bitsets indexed by token, so that asking
+ * whether a token can start or follow a nonterminal is a single bit test.
+ * llgen works them out from the grammar, so they're tables in lltab.c.
+ */
+
+#include <stdio.h>
+#include "sets.h"
+
+tokset_t first(int sym)
+{
+    /* FIRST of a terminal is the terminal itself. */
+
+    return ISNONTERM(sym) ? Ll_first[sym - NTERMS] : TOKBIT(sym);
+}
+
+tokset_t follow(nonterm_t sym)
+{
+    return Ll_follow[sym - NTERMS];
+}
+
+bool legal_lookahead(compiler_t *c, tokset_t legal)
+{
+    /* Simple error detection and recovery. "legal" is the set of tokens that
+     * can legitimately come next in the input. If it's empty, the end of
+     * file must come next. Print an error message if necessary. Error
+     * recovery is performed by discarding all input symbols until one in
+     * "legal" is found, or until a synchronizing token: a semicolon, or
+     * anything that can follow a complete program; an error is reported
+     * even when there's nothing to discard. The discarding is done
+     * by lex_sync(), in one scan of the input rather than a token at a
+     * time.
+     *
+     * Return true if there's no error or if we recovered from the error,
+     * false if we can't recover.
+     */
+    tokset_t synch = TOKBIT(SEMI) | follow(STATEMENTS);
+
+    if (!legal) {
+        return match(c, EOI);
+    }
+    if (IN_SET(legal, lookahead(c))) {
+        return true;
+    }
+
+    yyerror(c, "Syntax error");
+    if (IN_SET(synch, lookahead(c))) {
+        return false;
+    }
+    return IN_SET(legal, lex_sync(c, legal | synch));
+}
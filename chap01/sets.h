@@ -0,0 +1,25 @@
+/* sets.h
+ *
+ * FIRST and FOLLOW sets of the grammar in ll1.g, as token bitsets. llgen
+ * works them out along with the parse tables and writes them to lltab.c.
+ */
+#ifndef SETS_H
+#define SETS_H
+
+#include "ll1.h"
+
+typedef unsigned int tokset_t;      /* one bit per token_t */
+
+#define TOKBIT(tok)         ((tokset_t)1 << (tok))
+#define IN_SET(set, tok)    (((set) >> (tok)) & 1)
+
+/* in lltab.c */
+extern const tokset_t Ll_first[NNONTERMS];
+extern const tokset_t Ll_follow[NNONTERMS];
+
+/* in sets.c */
+tokset_t first(int sym);
+tokset_t follow(nonterm_t sym);
+bool legal_lookahead(compiler_t *c, tokset_t legal);
+
+#endif /* SETS_H */
@@ -0,0 +1,98 @@
+/* timing.c
+ *
+ * Per-phase clocks. Each thread keeps its own totals, and merge_timing()
+ * adds them up when the thread is done, the same way merge_pressure()
+ * does in name.c. With several threads the totals are thread time, not
+ * elapsed time.
+ */
+
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include "timing.h"
+
+bool Timing = false;
+
+static const char *const Names[NPHASES] = {
+    [PHASE_PARSE]    = "parse",
+    [PHASE_LEX]      = "lex",
+    [PHASE_OPTIMIZE] = "optimize",
+    [PHASE_BACKEND]  = "back end",
+    [PHASE_OUTPUT]   = "output",
+};
+
+static _Thread_local phase_t Current;
+static _Thread_local uint64_t Since;            /* when Current began, ns */
+static _Thread_local uint64_t Spent[NPHASES];   /* ns in each phase */
+
+static uint64_t Total[NPHASES];                 /* merged from every thread */
+static pthread_mutex_t Lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+phase_t phase_switch(phase_t p)
+{
+    phase_t old = Current;
+    uint64_t t = now();
+
+    if (Since) {
+        Spent[Current] += t - Since;
+    }
+    Since = t;
+    Current = p;
+    return old;
+}
+
+void merge_timing(void)
+{
+    /* Add this thread's totals, including the phase it's in now, to the
+     * program's.
+     */
+    int p;
+
+    if (!Timing) {
+        return;
+    }
+    phase_switch(Current);
+    pthread_mutex_lock(&Lock);
+    for (p = 0; p < NPHASES; ++p) {
+        Total[p] += Spent[p];
+        Spent[p] = 0;
+    }
+    pthread_mutex_unlock(&Lock);
+}
+
+void print_timing(FILE *fp)
+{
+    uint64_t sum = 0;
+    int p;
+
+    for (p = 0; p < NPHASES; ++p) {
+        sum += Total[p];
+    }
+    fprintf(fp, "Time: %.3fs\n", sum / 1e9);
+    for (p = 0; p < NPHASES; ++p) {
+        fprintf(fp, "%10s %9.3fs %5.1f%%\n", Names[p], Total[p] / 1e9,
+                sum ? 100.0 * Total[p] / sum : 0.0);
+    }
+    print_rss(fp);
+}
+
+void print_rss(FILE *fp)
+{
+    /* Report the most memory the process has had. Unlike the phase times,
+     * this costs nothing while compiling.
+     */
+    struct rusage ru;
+
+    if (getrusage(RUSAGE_SELF, &ru) == 0) {
+        fprintf(fp, "Peak RSS: %ld KB\n", ru.ru_maxrss);
+    }
+}
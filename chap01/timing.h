@@ -0,0 +1,36 @@
+/* timing.h
+ *
+ * Where the time goes (-t). Each thread is always in one phase, and
+ * phase() charges the time since the last switch to the phase it's
+ * leaving. Anything that isn't lexing, optimizing, running a back end or
+ * writing output counts as parsing.
+ */
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+typedef enum {
+    PHASE_PARSE,
+    PHASE_LEX,
+    PHASE_OPTIMIZE,
+    PHASE_BACKEND,          /* emitting text, or compiling and running */
+    PHASE_OUTPUT,           /* write() */
+    NPHASES,
+} phase_t;
+
+extern bool Timing;
+
+/* Enter phase "p" and return the one that was left, to go back to later.
+ * Costs only a test when timing is off.
+ */
+#define phase(p)    (Timing ? phase_switch(p) : (p))
+
+/* in timing.c */
+phase_t phase_switch(phase_t p);
+void merge_timing(void);
+void print_timing(FILE *fp);
+void print_rss(FILE *fp);
+
+#endif /* TIMING_H */
@@ -0,0 +1,71 @@
+/* Parser that builds a syntax tree instead of emitting code as it goes.
+ * It's the precedence-climbing parser from improved.c with each function
+ * returning the node it recognized.
+ */
+
+#include <stdio.h>
+#include "ast.h"
+#include "sets.h"
+
+static node_t binary(compiler_t *c, arena_t *arena, int min_prec);
+static node_t factor(compiler_t *c, arena_t *arena);
+
+/* Binary operators, indexed by token, with their precedence (0 for tokens
+ * that aren't operators; higher numbers bind tighter).
+ */
+static const int Prec[UNKNOWN] = {
+    [PLUS]  = 1,
+    [TIMES] = 2,
+};
+
+node_t tree_expression(compiler_t *c, arena_t *arena)
+{
+    /* expression -> factor (binop factor)* */
+    return binary(c, arena, 1);
+}
+
+static node_t binary(compiler_t *c, arena_t *arena, int min_prec)
+{
+    node_t left, right;
+    token_t op;
+
+    left = factor(c, arena);
+    while (Prec[op = lookahead(c)] >= min_prec) {
+        advance(c);
+        right = binary(c, arena, Prec[op] + 1);
+        left = ast_binary(arena, op, left, right);
+    }
+
+    return left;
+}
+
+static node_t factor(compiler_t *c, arena_t *arena)
+{
+    /* factor -> NUM
+     *        |  ID
+     *        |  LP expression RP
+     */
+    node_t node = 0;
+
+    if (! legal_lookahead(c, first(FACTOR))) {
+        return 0;
+    }
+
+    if (match(c, NUM)) {
+        node = ast_num(arena, c->lval);
+        advance(c);
+    } else if (match(c, ID)) {
+        node = ast_id(arena, c->text, c->leng);
+        advance(c);
+    } else if (match(c, LP)) {
+        advance(c);
+        node = tree_expression(c, arena);
+        if (match(c, RP)) {
+            advance(c);
+        } else {
+            yyerror(c, "Mismatched parenthesis");
+        }
+    }
+
+    return node;
+}
@@ -0,0 +1,219 @@
+/* vm.c
+ *
+ * Evaluating statements in-process. A statement's optimized quads are
+ * compiled to the register bytecode described in vm.h and run by a
+ * threaded interpreter: every instruction handler ends by jumping
+ * straight to the next one's through a table of label addresses (a GCC
+ * extension), with no central switch to come back to. Identifiers are
+ * looked up in a variable table once, at compile time, and the bytecode
+ * refers to them by slot; one without a value (see -D in main.c) is 0.
+ * Arithmetic wraps, like the constant folder's.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "lex.h"
+#include "vm.h"
+
+typedef struct {
+    const char *name;
+    int len;
+} var_t;
+
+static unsigned long Unbound[1];
+unsigned long *Vm_vars = Unbound;   /* values, indexed by slot */
+static var_t *Vars;             /* names, ditto */
+static int Nvars = 1, Maxvars;  /* slot 0 is the unbound variable */
+
+static void *xrealloc(void *p, size_t size)
+{
+    if (!(p = realloc(p, size))) {
+        fprintf(stderr, "Out of memory for bytecode\n");
+        exit(1);
+    }
+    return p;
+}
+
+int vm_var(const char *name, int len)
+{
+    /* Return the slot bound to a name, or 0 if there isn't one. There are
+     * only ever a handful of them, so a linear search will do. The table
+     * doesn't change once compiling starts, so threads can share it.
+     */
+    int i;
+
+    for (i = 1; i < Nvars; ++i) {
+        if (Vars[i].len == len && memcmp(Vars[i].name, name, len) == 0) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+void vm_bind(const char *name, int len, unsigned long value)
+{
+    /* Give a variable a value, before any statement is compiled. */
+
+    int i;
+
+    if (!(i = vm_var(name, len))) {
+        if (Nvars >= Maxvars) {
+            Vm_vars = xrealloc(Maxvars ? Vm_vars : NULL,
+                               (Maxvars ? Maxvars * 2 : 16)
+                               * sizeof(unsigned long));
+            Maxvars = Maxvars ? Maxvars * 2 : 16;
+            Vars = xrealloc(Vars, Maxvars * sizeof(var_t));
+            Vm_vars[0] = 0;
+        }
+        i = Nvars++;
+        Vars[i].name = name;
+        Vars[i].len = len;
+    }
+    Vm_vars[i] = value;
+}
+
+static int slot(ir_t *ir, int opnd)
+{
+    return vm_var(IR_SYM_NAME(ir, opnd), IR_SYM(ir, opnd)->len);
+}
+
+static void gen(vm_prog_t *prog, vm_op_t op, int dst, int a, uint32_t b)
+{
+    vm_insn_t *p;
+
+    if (prog->ncode >= prog->maxcode) {
+        prog->maxcode = prog->maxcode ? prog->maxcode * 2 : 64;
+        prog->code = xrealloc(prog->code, prog->maxcode * sizeof(vm_insn_t));
+    }
+    p = &prog->code[prog->ncode++];
+    p->op = op;
+    p->dst = dst;
+    p->a = a;
+    p->b = b;
+}
+
+static uint32_t constant(vm_prog_t *prog, unsigned long value)
+{
+    if (prog->nconsts >= prog->maxconsts) {
+        prog->maxconsts = prog->maxconsts ? prog->maxconsts * 2 : 16;
+        prog->consts = xrealloc(prog->consts,
+                                prog->maxconsts * sizeof(unsigned long));
+    }
+    prog->consts[prog->nconsts] = value;
+    return prog->nconsts++;
+}
+
+static void load(vm_prog_t *prog, ir_t *ir, int dst, int opnd)
+{
+    switch (OPND_KIND(opnd)) {
+        case OPND_TEMP:
+            if (OPND_INDEX(opnd) != dst) {
+                gen(prog, VM_MOVE, dst, OPND_INDEX(opnd), 0);
+            }
+            break;
+        case OPND_NUM:
+            gen(prog, VM_LOADK, dst, 0, constant(prog, IR_NUM(ir, opnd)));
+            break;
+        default:
+            gen(prog, VM_LOADV, dst, 0, slot(ir, opnd));
+            break;
+    }
+}
+
+bool vm_compile(vm_prog_t *prog, ir_t *ir)
+{
+    /* Compile a statement's quads, replacing whatever prog held. Return
+     * false if there's nothing to run: the statement is empty, or it needs
+     * more temporaries than there are registers.
+     */
+    static const vm_op_t opcode[][3] = {    /* by source 2's kind */
+        [Q_ADD] = { [OPND_TEMP] = VM_ADD, [OPND_NUM] = VM_ADDK,
+                    [OPND_ID] = VM_ADDV },
+        [Q_MUL] = { [OPND_TEMP] = VM_MUL, [OPND_NUM] = VM_MULK,
+                    [OPND_ID] = VM_MULV },
+    };
+    ir_quad_t *q;
+    int dst, src1, src2, t;
+    uint32_t b;
+
+    prog->ncode = 0;
+    prog->nconsts = 0;
+    if (ir->nquads == 0) {
+        return false;
+    }
+
+    for (q = ir->quads; q < ir->quads + ir->nquads; ++q) {
+        if ((dst = OPND_INDEX(q->dst)) >= VM_NREGS) {
+            return false;
+        }
+        if (q->op == Q_MOVE) {
+            load(prog, ir, dst, q->src1);
+            continue;
+        }
+
+        /* Get a register into source 1, without clobbering source 2. */
+        src1 = q->src1;
+        src2 = q->src2;
+        if (OPND_KIND(src1) != OPND_TEMP || src2 == q->dst) {
+            t = src1;
+            src1 = src2;
+            src2 = t;
+        }
+        if (OPND_KIND(src1) != OPND_TEMP) {
+            load(prog, ir, dst, src1);
+            src1 = q->dst;
+        }
+
+        switch (OPND_KIND(src2)) {
+            case OPND_TEMP: b = OPND_INDEX(src2);                 break;
+            case OPND_NUM:  b = constant(prog, IR_NUM(ir, src2)); break;
+            default:        b = slot(ir, src2);                   break;
+        }
+        gen(prog, opcode[q->op][OPND_KIND(src2)], dst, OPND_INDEX(src1), b);
+    }
+    gen(prog, VM_HALT, OPND_INDEX(ir->quads[ir->nquads - 1].dst), 0, 0);
+    return true;
+}
+
+unsigned long vm_exec(const vm_prog_t *prog, const unsigned long *vars)
+{
+    static void *const dispatch[] = {
+        [VM_HALT]  = &&halt,
+        [VM_MOVE]  = &&move,
+        [VM_LOADK] = &&loadk,
+        [VM_LOADV] = &&loadv,
+        [VM_ADD]   = &&add,
+        [VM_ADDK]  = &&addk,
+        [VM_ADDV]  = &&addv,
+        [VM_MUL]   = &&mul,
+        [VM_MULK]  = &&mulk,
+        [VM_MULV]  = &&mulv,
+    };
+    const vm_insn_t *ip = prog->code;
+    const unsigned long *k = prog->consts;
+    unsigned long r[VM_NREGS];
+
+#define NEXT    goto *dispatch[(++ip)->op]
+
+    goto *dispatch[ip->op];
+
+move:   r[ip->dst] = r[ip->a];              NEXT;
+loadk:  r[ip->dst] = k[ip->b];              NEXT;
+loadv:  r[ip->dst] = vars[ip->b];           NEXT;
+add:    r[ip->dst] = r[ip->a] + r[ip->b];   NEXT;
+addk:   r[ip->dst] = r[ip->a] + k[ip->b];   NEXT;
+addv:   r[ip->dst] = r[ip->a] + vars[ip->b]; NEXT;
+mul:    r[ip->dst] = r[ip->a] * r[ip->b];   NEXT;
+mulk:   r[ip->dst] = r[ip->a] * k[ip->b];   NEXT;
+mulv:   r[ip->dst] = r[ip->a] * vars[ip->b]; NEXT;
+halt:   return r[ip->dst];
+
+#undef NEXT
+}
+
+void vm_free(vm_prog_t *prog)
+{
+    free(prog->code);
+    free(prog->consts);
+    memset(prog, 0, sizeof(*prog));
+}
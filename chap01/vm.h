@@ -0,0 +1,57 @@
+/* vm.h
+ *
+ * A register bytecode for statements, and an interpreter for it. Each
+ * instruction is eight bytes: an opcode, a destination register, and two
+ * sources. The first source is always a register; the second is a
+ * register, a constant-pool index or a variable slot, depending on the
+ * opcode.
+ */
+#ifndef VM_H
+#define VM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "ir.h"
+
+#define VM_NREGS    256     /* registers, one per temporary */
+
+typedef enum {
+    VM_HALT,                /* return r[dst]           */
+    VM_MOVE,                /* r[dst] = r[a]           */
+    VM_LOADK,               /* r[dst] = k[b]           */
+    VM_LOADV,               /* r[dst] = v[b]           */
+    VM_ADD,                 /* r[dst] = r[a] + r[b]    */
+    VM_ADDK,                /* r[dst] = r[a] + k[b]    */
+    VM_ADDV,                /* r[dst] = r[a] + v[b]    */
+    VM_MUL,                 /* r[dst] = r[a] * r[b]    */
+    VM_MULK,                /* r[dst] = r[a] * k[b]    */
+    VM_MULV,                /* r[dst] = r[a] * v[b]    */
+} vm_op_t;
+
+typedef struct {
+    uint8_t op;
+    uint8_t dst;
+    uint16_t a;
+    uint32_t b;
+} vm_insn_t;
+
+typedef struct {
+    vm_insn_t *code;
+    int ncode, maxcode;
+    unsigned long *consts;  /* k[] */
+    int nconsts, maxconsts;
+} vm_prog_t;
+
+/* The variable table, v[]. Slot 0 is never bound and always holds 0: it
+ * stands for every identifier without a value.
+ */
+extern unsigned long *Vm_vars;
+
+/* in vm.c */
+void vm_bind(const char *name, int len, unsigned long value);
+int vm_var(const char *name, int len);
+bool vm_compile(vm_prog_t *prog, ir_t *ir);
+unsigned long vm_exec(const vm_prog_t *prog, const unsigned long *vars);
+void vm_free(vm_prog_t *prog);
+
+#endif /* VM_H */